@@ -0,0 +1,525 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>   // For size_t needed by sasl.h.
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <sasl/sasl.h>
+
+#include <mesos/mesos.hpp>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/once.hpp>
+#include <process/owned.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/check.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/none.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "authentication/cram_md5/authenticatee.hpp"
+
+// We need to disable the deprecation warnings as Apple has decided
+// to deprecate all of CyrusSASL's functions with OS 10.11
+// (see MESOS-3030). We are using GCC pragmas also for covering clang.
+#ifdef __APPLE__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+using namespace process;
+
+using mesos::internal::AuthenticateMessage;
+using mesos::internal::AuthenticationCompletedMessage;
+using mesos::internal::AuthenticationErrorMessage;
+using mesos::internal::AuthenticationFailedMessage;
+using mesos::internal::AuthenticationMechanismsMessage;
+using mesos::internal::AuthenticationStartMessage;
+using mesos::internal::AuthenticationStepMessage;
+
+using std::string;
+
+// Runs all authentications of an authenticatee within a single
+// process, one attempt per master at a time, just like the
+// authenticator multiplexes its sessions. Messages of the
+// authenticator get routed to their attempt by the address they come
+// from; a new attempt against the same master supersedes the one in
+// flight.
+class CRAMMD5AuthenticateeProcess
+  : public ProtobufProcess<CRAMMD5AuthenticateeProcess>
+{
+public:
+  CRAMMD5AuthenticateeProcess()
+    : ProcessBase(ID::generate("crammd5_authenticatee")),
+      attemptId(0) {}
+
+  virtual ~CRAMMD5AuthenticateeProcess() {}
+
+  virtual void finalize()
+  {
+    foreachvalue (const Owned<Attempt>& attempt, attempts) {
+      attempt->promise.fail("Authentication discarded");
+    }
+
+    attempts.clear();
+  }
+
+  Future<bool> authenticate(
+      const UPID& pid,
+      const UPID& client,
+      const Credential& credential)
+  {
+    Try<Nothing> initialized = initializeClient();
+    if (initialized.isError()) {
+      return Failure(initialized.error());
+    }
+
+    const string key = stringify(pid.address);
+
+    Option<Owned<Attempt>> previous = attempts.get(key);
+    if (previous.isSome()) {
+      LOG(INFO) << "Superseding authentication in flight against " << pid;
+      fail(previous.get(), "Authentication superseded by a new attempt");
+    }
+
+    Owned<Attempt> attempt(new Attempt(attemptId++, pid, credential));
+
+    LOG(INFO) << "Creating new client SASL connection";
+
+    int result = sasl_client_new(
+        "mesos",              // Registered name of service.
+        NULL,                 // Server's FQDN.
+        NULL, NULL,           // IP Address information strings.
+        attempt->callbacks,   // Callbacks supported only for this
+                              // connection.
+        0,                    // Security flags (security layers are
+                              // enabled using security properties,
+                              // separately).
+        &attempt->connection);
+
+    if (result != SASL_OK) {
+      return Failure(
+          string("Failed to create client SASL connection: ") +
+          sasl_errstring(result, NULL, NULL));
+    }
+
+    attempts.put(key, attempt);
+
+    AuthenticateMessage message;
+    message.set_pid(client);
+    send(pid, message);
+
+    attempt->status = Attempt::STARTING;
+
+    // Stop authenticating if nobody cares. The attempt id guards
+    // against discarding a later attempt against the same master.
+    Future<bool> future = attempt->promise.future();
+    future.onDiscard(defer(self(), &Self::discarded, key, attempt->id));
+
+    return future;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    // Anticipate mechanisms and steps from the servers.
+    install<AuthenticationMechanismsMessage>(
+        &CRAMMD5AuthenticateeProcess::mechanisms,
+        &AuthenticationMechanismsMessage::mechanisms);
+
+    install<AuthenticationStepMessage>(
+        &CRAMMD5AuthenticateeProcess::step,
+        &AuthenticationStepMessage::data);
+
+    install<AuthenticationCompletedMessage>(
+        &CRAMMD5AuthenticateeProcess::completed);
+
+    install<AuthenticationFailedMessage>(
+        &CRAMMD5AuthenticateeProcess::failed);
+
+    install<AuthenticationErrorMessage>(
+        &CRAMMD5AuthenticateeProcess::error,
+        &AuthenticationErrorMessage::error);
+  }
+
+  void mechanisms(const UPID& from, const std::vector<string>& mechanisms)
+  {
+    Option<Owned<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    Owned<Attempt> attempt = attempt_.get();
+
+    if (attempt->status != Attempt::STARTING) {
+      fail(attempt, "Unexpected authentication 'mechanisms' received");
+      return;
+    }
+
+    LOG(INFO) << "Received SASL authentication mechanisms: "
+              << strings::join(",", mechanisms);
+
+    sasl_interact_t* interact = NULL;
+    const char* output = NULL;
+    unsigned length = 0;
+    const char* mechanism = NULL;
+
+    int result = sasl_client_start(
+        attempt->connection,
+        strings::join(" ", mechanisms).c_str(),
+        &interact,     // Set if an interaction is needed.
+        &output,       // The output string (to send to server).
+        &length,       // The length of the output string.
+        &mechanism);   // The chosen mechanism.
+
+    CHECK_NE(SASL_INTERACT, result)
+      << "Not expecting an interaction (ID: " << interact->id << ")";
+
+    if (result != SASL_OK && result != SASL_CONTINUE) {
+      fail(attempt,
+           string("Failed to start the SASL client: ") +
+           sasl_errdetail(attempt->connection));
+      return;
+    }
+
+    LOG(INFO) << "Attempting to authenticate with mechanism '"
+              << mechanism << "'";
+
+    AuthenticationStartMessage message;
+    message.set_mechanism(mechanism);
+    message.set_data(output, length);
+
+    send(from, message);
+
+    attempt->status = Attempt::STEPPING;
+  }
+
+  void step(const UPID& from, const string& data)
+  {
+    Option<Owned<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    Owned<Attempt> attempt = attempt_.get();
+
+    if (attempt->status != Attempt::STEPPING) {
+      fail(attempt, "Unexpected authentication 'step' received");
+      return;
+    }
+
+    LOG(INFO) << "Received SASL authentication step";
+
+    sasl_interact_t* interact = NULL;
+    const char* output = NULL;
+    unsigned length = 0;
+
+    int result = sasl_client_step(
+        attempt->connection,
+        data.length() == 0 ? NULL : data.data(),
+        data.length(),
+        &interact,
+        &output,
+        &length);
+
+    CHECK_NE(SASL_INTERACT, result)
+      << "Not expecting an interaction (ID: " << interact->id << ")";
+
+    if (result != SASL_OK && result != SASL_CONTINUE) {
+      fail(attempt,
+           string("Failed to perform authentication step: ") +
+           sasl_errdetail(attempt->connection));
+      return;
+    }
+
+    // We don't start the client with SASL_SUCCESS_DATA so we may
+    // need to send one more "empty" message to the server.
+    AuthenticationStepMessage message;
+    if (output != NULL && length > 0) {
+      message.set_data(output, length);
+    }
+
+    send(from, message);
+  }
+
+  void completed(const UPID& from)
+  {
+    Option<Owned<Attempt>> attempt = find(from);
+    if (attempt.isNone()) {
+      return;
+    }
+
+    if (attempt.get()->status != Attempt::STEPPING) {
+      fail(attempt.get(), "Unexpected authentication 'completed' received");
+      return;
+    }
+
+    LOG(INFO) << "Authentication success";
+
+    attempt.get()->promise.set(true);
+    attempts.erase(stringify(from.address));
+  }
+
+  void failed(const UPID& from)
+  {
+    Option<Owned<Attempt>> attempt = find(from);
+    if (attempt.isSome()) {
+      attempt.get()->promise.set(false);
+      attempts.erase(stringify(from.address));
+    }
+  }
+
+  void error(const UPID& from, const string& error)
+  {
+    Option<Owned<Attempt>> attempt = find(from);
+    if (attempt.isSome()) {
+      fail(attempt.get(), "Authentication error: " + error);
+    }
+  }
+
+  void discarded(const string& key, uint64_t id)
+  {
+    Option<Owned<Attempt>> attempt = attempts.get(key);
+    if (attempt.isSome() && attempt.get()->id == id) {
+      fail(attempt.get(), "Authentication discarded");
+    }
+  }
+
+private:
+  struct Attempt
+  {
+    Attempt(uint64_t _id, const UPID& _pid, const Credential& _credential)
+      : id(_id),
+        pid(_pid),
+        principal(_credential.principal()),
+        status(STARTING),
+        connection(NULL)
+    {
+      const string& data = _credential.secret();
+
+      // Need to allocate the secret via 'malloc' because SASL is
+      // expecting the data appended to the end of the struct. *sigh*
+      secret = (sasl_secret_t*) malloc(sizeof(sasl_secret_t) + data.size());
+
+      CHECK(secret != NULL) << "Failed to allocate memory for secret";
+
+      memcpy(secret->data, data.data(), data.size());
+      secret->len = data.size();
+
+      callbacks[0].id = SASL_CB_GETREALM;
+      callbacks[0].proc = NULL;
+      callbacks[0].context = NULL;
+
+      callbacks[1].id = SASL_CB_USER;
+      callbacks[1].proc = (int(*)()) &user;
+      callbacks[1].context = (void*) principal.c_str();
+
+      // NOTE: Some SASL mechanisms do not allow/enable "proxying",
+      // i.e., authorization. Therefore, some mechanisms send _only_
+      // the authorization name rather than both the user
+      // (authentication name) and authorization name. Thus, for now,
+      // we assume authorization is handled out-of-band. Consider the
+      // SASL_NEED_PROXY flag if we want to reconsider this in the
+      // future.
+      callbacks[2].id = SASL_CB_AUTHNAME;
+      callbacks[2].proc = (int(*)()) &user;
+      callbacks[2].context = (void*) principal.c_str();
+
+      callbacks[3].id = SASL_CB_PASS;
+      callbacks[3].proc = (int(*)()) &pass;
+      callbacks[3].context = (void*) secret;
+
+      callbacks[4].id = SASL_CB_LIST_END;
+      callbacks[4].proc = NULL;
+      callbacks[4].context = NULL;
+    }
+
+    ~Attempt()
+    {
+      if (connection != NULL) {
+        sasl_dispose(&connection);
+      }
+      free(secret);
+    }
+
+    const uint64_t id;
+
+    // PID of the master.
+    const UPID pid;
+
+    const string principal;
+    sasl_secret_t* secret;
+
+    sasl_callback_t callbacks[5];
+
+    enum {
+      STARTING,
+      STEPPING
+    } status;
+
+    sasl_conn_t* connection;
+
+    Promise<bool> promise;
+  };
+
+  // Initializes the SASL client library once per process.
+  static Try<Nothing> initializeClient()
+  {
+    static Once* initialize = new Once();
+    static Option<Error>* error = new Option<Error>();
+
+    if (!initialize->once()) {
+      LOG(INFO) << "Initializing client SASL";
+
+      int result = sasl_client_init(NULL);
+      if (result != SASL_OK) {
+        *error = Error(
+            string("Failed to initialize SASL: ") +
+            sasl_errstring(result, NULL, NULL));
+      }
+
+      initialize->done();
+    }
+
+    if (error->isSome()) {
+      return error->get();
+    }
+
+    return Nothing();
+  }
+
+  // Looks up the attempt against the master at the address 'from'
+  // came from.
+  Option<Owned<Attempt>> find(const UPID& from)
+  {
+    Option<Owned<Attempt>> attempt = attempts.get(stringify(from.address));
+
+    if (attempt.isNone()) {
+      LOG(WARNING) << "Ignoring authentication message from " << from
+                   << " without an attempt in flight";
+    }
+
+    return attempt;
+  }
+
+  // Fails 'attempt' and drops it unless it got superseded already.
+  void fail(const Owned<Attempt>& attempt, const string& message)
+  {
+    attempt->promise.fail(message);
+
+    const string key = stringify(attempt->pid.address);
+
+    Option<Owned<Attempt>> current = attempts.get(key);
+    if (current.isSome() && current.get()->id == attempt->id) {
+      attempts.erase(key);
+    }
+  }
+
+  static int user(
+      void* context,
+      int id,
+      const char** result,
+      unsigned* length)
+  {
+    CHECK(SASL_CB_USER == id || SASL_CB_AUTHNAME == id);
+    *result = static_cast<const char*>(context);
+    if (length != NULL) {
+      *length = strlen(*result);
+    }
+    return SASL_OK;
+  }
+
+  static int pass(
+      sasl_conn_t* connection,
+      void* context,
+      int id,
+      sasl_secret_t** secret)
+  {
+    CHECK_EQ(SASL_CB_PASS, id);
+    *secret = static_cast<sasl_secret_t*>(context);
+    return SASL_OK;
+  }
+
+  uint64_t attemptId;
+
+  // Attempts in flight, by the address of their master.
+  hashmap<string, Owned<Attempt>> attempts;
+};
+
+
+Try<Authenticatee*> CRAMMD5Authenticatee::create()
+{
+  return new CRAMMD5Authenticatee();
+}
+
+
+CRAMMD5Authenticatee::CRAMMD5Authenticatee() : process(NULL) {}
+
+
+CRAMMD5Authenticatee::~CRAMMD5Authenticatee()
+{
+  if (process != NULL) {
+    terminate(process);
+    wait(process);
+    delete process;
+  }
+}
+
+
+Future<bool> CRAMMD5Authenticatee::authenticate(
+    const UPID& pid,
+    const UPID& client,
+    const Credential& credential)
+{
+  // The process outlives single authentications.
+  if (process == NULL) {
+    process = new CRAMMD5AuthenticateeProcess();
+    spawn(process);
+  }
+
+  return dispatch(
+      process,
+      &CRAMMD5AuthenticateeProcess::authenticate,
+      pid,
+      client,
+      credential);
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#ifdef __APPLE__
+#pragma GCC diagnostic pop
+#endif
@@ -29,13 +29,18 @@
 #include <stout/try.hpp>
 
 namespace mesos {
-namespace internal {
+namespace modules {
 namespace cram_md5 {
 
 // Forward declaration.
 class CRAMMD5AuthenticateeProcess;
 
 
+// Note that libmesos has its own authenticatee of the same name in
+// 'mesos::internal::cram_md5'; the module's one lives in
+// 'mesos::modules' to keep the symbols of both apart. Unlike the
+// libmesos one it can authenticate repeatedly, against any number of
+// masters, all within a single process.
 class CRAMMD5Authenticatee : public Authenticatee
 {
 public:
@@ -56,7 +61,7 @@ private:
 };
 
 } // namespace cram_md5 {
-} // namespace internal {
+} // namespace modules {
 } // namespace mesos {
 
 #endif //__AUTHENTICATION_CRAM_MD5_AUTHENTICATEE_HPP__
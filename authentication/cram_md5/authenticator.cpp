@@ -0,0 +1,546 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>   // For size_t needed by sasl.h.
+#include <string.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sasl/sasl.h>
+
+#include <mesos/mesos.hpp>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/once.hpp>
+#include <process/owned.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/check.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/multimap.hpp>
+#include <stout/strings.hpp>
+
+#include "authentication/cram_md5/authenticator.hpp"
+#include "authentication/cram_md5/auxprop.hpp"
+#include "authentication/cram_md5/credential_database.hpp"
+#include "authentication/cram_md5/credentials.hpp"
+#include "authentication/cram_md5/credentials_watcher.hpp"
+#include "authentication/cram_md5/property_store.hpp"
+
+// We need to disable the deprecation warnings as Apple has decided
+// to deprecate all of CyrusSASL's functions with OS 10.11
+// (see MESOS-3030). We are using GCC pragmas also for covering clang.
+#ifdef __APPLE__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+using namespace process;
+
+using mesos::internal::AuthenticationCompletedMessage;
+using mesos::internal::AuthenticationErrorMessage;
+using mesos::internal::AuthenticationFailedMessage;
+using mesos::internal::AuthenticationMechanismsMessage;
+using mesos::internal::AuthenticationStartMessage;
+using mesos::internal::AuthenticationStepMessage;
+
+using std::string;
+
+// Runs all authentication sessions of an authenticator within a
+// single process; messages from the authenticatees get routed to
+// their session by the sending pid instead of spawning a process
+// per session.
+class CRAMMD5AuthenticatorProcess
+  : public ProtobufProcess<CRAMMD5AuthenticatorProcess>
+{
+public:
+  explicit CRAMMD5AuthenticatorProcess(const string& _auxprop)
+    : ProcessBase(ID::generate("crammd5_authenticator")),
+      auxprop(_auxprop),
+      sessionId(0)
+  {
+    // Every connection reads its options from here, most importantly
+    // the auxiliary property plugin holding our credentials.
+    callbacks[0].id = SASL_CB_GETOPT;
+    callbacks[0].proc = (int(*)()) &getopt;
+    callbacks[0].context = (void*) this;
+
+    callbacks[1].id = SASL_CB_LIST_END;
+    callbacks[1].proc = NULL;
+    callbacks[1].context = NULL;
+  }
+
+  virtual ~CRAMMD5AuthenticatorProcess() {}
+
+  virtual void finalize()
+  {
+    foreachvalue (const Owned<Session>& session, sessions) {
+      session->promise.fail("Authentication discarded");
+    }
+
+    sessions.clear();
+  }
+
+  Future<Option<string>> authenticate(const UPID& pid)
+  {
+    VLOG(1) << "Starting authentication session for " << pid;
+
+    if (sessions.contains(pid)) {
+      return Failure("Authentication session already active for " +
+                     string(pid));
+    }
+
+    Owned<Session> session(new Session(pid, sessionId++));
+
+    LOG(INFO) << "Creating new server SASL connection";
+
+    int result = sasl_server_new(
+        "mesos",    // Registered name of service.
+        NULL,       // Server's FQDN; NULL uses gethostname().
+        NULL,       // The user realm used for password lookups;
+                    // NULL means default to FQDN.
+                    // NOTE: This does not affect Kerberos.
+        NULL, NULL, // IP address information strings.
+        callbacks,  // Callbacks supported only for this connection.
+        0,          // Security flags (security layers are enabled
+                    // using security properties, separately).
+        &session->connection);
+
+    if (result != SASL_OK) {
+      string error = "Failed to create server SASL connection: ";
+      error += sasl_errstring(result, NULL, NULL);
+      LOG(ERROR) << error;
+      AuthenticationErrorMessage message;
+      message.set_error(error);
+      send(pid, message);
+      return Failure(error);
+    }
+
+    // Get the list of mechanisms.
+    const char* output = NULL;
+    unsigned length = 0;
+    int count = 0;
+
+    result = sasl_listmech(
+        session->connection,  // The context for this connection.
+        NULL,                 // Not supported.
+        "",                   // What to prepend to the output string.
+        ",",                  // What to separate mechanisms with.
+        "",                   // What to append to the output string.
+        &output,              // The output string.
+        &length,              // The length of the output string.
+        &count);              // The count of the mechanisms in output.
+
+    if (result != SASL_OK || output == NULL) {
+      string error = "Failed to get list of mechanisms: ";
+      LOG(WARNING) << error << sasl_errstring(result, NULL, NULL);
+      AuthenticationErrorMessage message;
+      error += sasl_errdetail(session->connection);
+      message.set_error(error);
+      send(pid, message);
+      return Failure(error);
+    }
+
+    std::vector<string> mechanisms = strings::tokenize(output, ",");
+    LOG(INFO) << "Available mechanisms: " << output;
+
+    // Send authentication mechanisms.
+    AuthenticationMechanismsMessage message;
+    foreach (const string& mechanism, mechanisms) {
+      message.add_mechanisms(mechanism);
+    }
+
+    send(pid, message);
+
+    session->status = Session::STARTING;
+
+    link(pid); // Don't bother waiting for a lost authenticatee.
+
+    sessions.put(pid, session);
+
+    // Stop authenticating if nobody cares. The session id guards
+    // against discarding a later session of the same authenticatee.
+    Future<Option<string>> future = session->promise.future();
+    future.onDiscard(defer(self(), &Self::discarded, pid, session->id));
+
+    return future;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    // Anticipate start and steps messages from the clients.
+    install<AuthenticationStartMessage>(
+        &CRAMMD5AuthenticatorProcess::start,
+        &AuthenticationStartMessage::mechanism,
+        &AuthenticationStartMessage::data);
+
+    install<AuthenticationStepMessage>(
+        &CRAMMD5AuthenticatorProcess::step,
+        &AuthenticationStepMessage::data);
+  }
+
+  virtual void exited(const UPID& pid)
+  {
+    Option<Owned<Session>> session = sessions.get(pid);
+    if (session.isSome()) {
+      session.get()->promise.fail("Failed to communicate with authenticatee");
+      sessions.erase(pid);
+    }
+  }
+
+  void start(const UPID& from, const string& mechanism, const string& data)
+  {
+    Option<Owned<Session>> session = sessions.get(from);
+    if (session.isNone()) {
+      LOG(WARNING) << "Ignoring authentication 'start' from " << from
+                   << " without an active session";
+      return;
+    }
+
+    if (session.get()->status != Session::STARTING) {
+      error(session.get(), "Unexpected authentication 'start' received");
+      return;
+    }
+
+    LOG(INFO) << "Received SASL authentication start with "
+              << mechanism << " mechanism from " << from;
+
+    // Start the server.
+    const char* output = NULL;
+    unsigned length = 0;
+
+    int result = sasl_server_start(
+        session.get()->connection,
+        mechanism.c_str(),
+        data.length() == 0 ? NULL : data.data(),
+        data.length(),
+        &output,
+        &length);
+
+    handle(session.get(), result, output, length);
+  }
+
+  void step(const UPID& from, const string& data)
+  {
+    Option<Owned<Session>> session = sessions.get(from);
+    if (session.isNone()) {
+      LOG(WARNING) << "Ignoring authentication 'step' from " << from
+                   << " without an active session";
+      return;
+    }
+
+    if (session.get()->status != Session::STEPPING) {
+      error(session.get(), "Unexpected authentication 'step' received");
+      return;
+    }
+
+    LOG(INFO) << "Received SASL authentication step from " << from;
+
+    const char* output = NULL;
+    unsigned length = 0;
+
+    int result = sasl_server_step(
+        session.get()->connection,
+        data.length() == 0 ? NULL : data.data(),
+        data.length(),
+        &output,
+        &length);
+
+    handle(session.get(), result, output, length);
+  }
+
+  void discarded(const UPID& pid, uint64_t id)
+  {
+    Option<Owned<Session>> session = sessions.get(pid);
+    if (session.isSome() && session.get()->id == id) {
+      session.get()->promise.fail("Authentication discarded");
+      sessions.erase(pid);
+    }
+  }
+
+private:
+  struct Session
+  {
+    Session(const UPID& _pid, uint64_t _id)
+      : pid(_pid), id(_id), status(STARTING), connection(NULL) {}
+
+    ~Session()
+    {
+      if (connection != NULL) {
+        sasl_dispose(&connection);
+      }
+    }
+
+    const UPID pid;
+    const uint64_t id;
+
+    enum {
+      STARTING,
+      STEPPING
+    } status;
+
+    sasl_conn_t* connection;
+
+    Promise<Option<string>> promise;
+  };
+
+  // Helper for handling result of server start and step. Sessions
+  // get removed once they completed, hence 'session' is taken by
+  // value.
+  void handle(Owned<Session> session,
+              int result,
+              const char* output,
+              unsigned length)
+  {
+    if (result == SASL_OK) {
+      // Principal is set by the SASL library on a successful
+      // authentication.
+      const char* principal = NULL;
+
+      result = sasl_getprop(
+          session->connection,
+          SASL_USERNAME,
+          (const void**) &principal);
+
+      if (result != SASL_OK) {
+        LOG(ERROR) << "Failed to retrieve principal after successful "
+                   << "authentication: " << sasl_errstring(result, NULL, NULL);
+        error(session, sasl_errdetail(session->connection));
+        return;
+      }
+
+      LOG(INFO) << "Authentication success for " << session->pid;
+      // Note that we're not using SASL_SUCCESS_DATA which means that
+      // we should not have any data to send when we get a SASL_OK.
+      CHECK(output == NULL);
+      send(session->pid, AuthenticationCompletedMessage());
+      session->promise.set(Option<string>(CHECK_NOTNULL(principal)));
+      sessions.erase(session->pid);
+    } else if (result == SASL_CONTINUE) {
+      LOG(INFO) << "Authentication requires more steps";
+      AuthenticationStepMessage message;
+      message.set_data(CHECK_NOTNULL(output), length);
+      send(session->pid, message);
+      session->status = Session::STEPPING;
+    } else if (result == SASL_NOUSER || result == SASL_BADAUTH) {
+      LOG(WARNING) << "Authentication failure: "
+                   << sasl_errstring(result, NULL, NULL);
+      send(session->pid, AuthenticationFailedMessage());
+      session->promise.set(Option<string>::none());
+      sessions.erase(session->pid);
+    } else {
+      LOG(ERROR) << "Authentication error: "
+                 << sasl_errstring(result, NULL, NULL);
+      error(session, sasl_errdetail(session->connection));
+    }
+  }
+
+  // Fails and removes 'session' after reporting 'message' to the
+  // authenticatee.
+  void error(Owned<Session> session, const string& message_)
+  {
+    AuthenticationErrorMessage message;
+    message.set_error(message_);
+    send(session->pid, message);
+    session->promise.fail(message_);
+    sessions.erase(session->pid);
+  }
+
+  static int getopt(
+      void* context,
+      const char* plugin,
+      const char* option,
+      const char** result,
+      unsigned* length)
+  {
+    CRAMMD5AuthenticatorProcess* process =
+      static_cast<CRAMMD5AuthenticatorProcess*>(context);
+
+    bool found = false;
+    if (string(option) == "auxprop_plugin") {
+      *result = process->auxprop.c_str();
+      found = true;
+    } else if (string(option) == "mech_list") {
+      *result = "CRAM-MD5";
+      found = true;
+    } else if (string(option) == "pwcheck_method") {
+      *result = "auxprop";
+      found = true;
+    }
+
+    if (found && length != NULL) {
+      *length = strlen(*result);
+    }
+
+    return SASL_OK;
+  }
+
+  // Name of the auxiliary property plugin serving our credentials.
+  const string auxprop;
+
+  sasl_callback_t callbacks[2];
+
+  uint64_t sessionId;
+
+  hashmap<UPID, Owned<Session>> sessions;
+};
+
+
+Try<Authenticator*> CRAMMD5Authenticator::create()
+{
+  return new CRAMMD5Authenticator();
+}
+
+
+CRAMMD5Authenticator::CRAMMD5Authenticator()
+  : process(NULL),
+    watcher(NULL),
+    reloadInterval(DEFAULT_CREDENTIALS_RELOAD_INTERVAL) {}
+
+
+CRAMMD5Authenticator::~CRAMMD5Authenticator()
+{
+  if (process != NULL) {
+    terminate(process);
+    wait(process);
+    delete process;
+  }
+
+  delete watcher;
+
+  if (store) {
+    InMemoryAuxiliaryPropertyPlugin::detach(auxprop);
+  }
+}
+
+
+void CRAMMD5Authenticator::prepare(
+    const Option<string>& databasePath_,
+    const Option<string>& credentialsPath_,
+    const Duration& reloadInterval_)
+{
+  databasePath = databasePath_;
+  credentialsPath = credentialsPath_;
+  reloadInterval = reloadInterval_;
+}
+
+
+Try<Nothing> CRAMMD5Authenticator::initialize(
+    const Option<Credentials>& credentials)
+{
+  static Once* initialize = new Once();
+  static Option<Error>* error = new Option<Error>();
+
+  if (process != NULL) {
+    return Error("Authenticator initialized already");
+  }
+
+  if (!initialize->once()) {
+    LOG(INFO) << "Initializing server SASL";
+
+    int result = sasl_server_init(NULL, "mesos");
+
+    if (result != SASL_OK) {
+      *error = Error(
+          string("Failed to initialize SASL: ") +
+          sasl_errstring(result, NULL, NULL));
+    }
+
+    initialize->done();
+  }
+
+  if (error->isSome()) {
+    return error->get();
+  }
+
+  std::shared_ptr<PropertyStore> _store(new PropertyStore());
+
+  if (credentials.isSome()) {
+    Multimap<string, Property> properties;
+    foreach (const Credential& credential, credentials.get().credentials()) {
+      properties.put(
+          credential.principal(),
+          credentials::secret(credential.secret()));
+    }
+    _store->load(properties);
+  }
+
+  if (databasePath.isSome()) {
+    Try<CredentialDatabase*> database =
+      CredentialDatabase::open(databasePath.get());
+
+    if (database.isError()) {
+      return Error(
+          "Failed to open credential database '" + databasePath.get() +
+          "': " + database.error());
+    }
+
+    _store->mount(std::shared_ptr<const CredentialDatabase>(database.get()));
+  }
+
+  // Every authenticator serves its credentials through a plugin of
+  // its own so that multiple instances do not share credentials.
+  const string name = ID::generate(InMemoryAuxiliaryPropertyPlugin::name());
+
+  Try<Nothing> attach = InMemoryAuxiliaryPropertyPlugin::attach(name, _store);
+  if (attach.isError()) {
+    return Error("Failed to attach credentials: " + attach.error());
+  }
+
+  store = _store;
+  auxprop = name;
+
+  if (credentialsPath.isSome()) {
+    watcher = new CredentialsWatcher(
+        credentialsPath.get(), reloadInterval, store.get());
+  }
+
+  process = new CRAMMD5AuthenticatorProcess(auxprop);
+  spawn(process);
+
+  return Nothing();
+}
+
+
+Future<Option<string>> CRAMMD5Authenticator::authenticate(const UPID& pid)
+{
+  if (process == NULL) {
+    return Failure("Authenticator not initialized");
+  }
+  return dispatch(process, &CRAMMD5AuthenticatorProcess::authenticate, pid);
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#ifdef __APPLE__
+#pragma GCC diagnostic pop
+#endif
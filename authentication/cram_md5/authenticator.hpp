@@ -19,6 +19,7 @@
 #ifndef __AUTHENTICATION_CRAM_MD5_AUTHENTICATOR_HPP__
 #define __AUTHENTICATION_CRAM_MD5_AUTHENTICATOR_HPP__
 
+#include <memory>
 #include <string>
 
 #include <mesos/module/authenticator.hpp>
@@ -26,15 +27,21 @@
 #include <process/future.hpp>
 #include <process/id.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 
 namespace mesos {
-namespace internal {
+namespace modules {
 namespace cram_md5 {
 
-// Forward declaration.
+// Forward declarations.
 class CRAMMD5AuthenticatorProcess;
+class CredentialsWatcher;
+class PropertyStore;
+
+// How often a credentials file given to 'prepare' gets reread.
+const Duration DEFAULT_CREDENTIALS_RELOAD_INTERVAL = Seconds(10);
 
 class CRAMMD5Authenticator : public Authenticator
 {
@@ -46,6 +53,14 @@ public:
 
   virtual ~CRAMMD5Authenticator();
 
+  // Optional credential sources in addition to the credentials passed
+  // to 'initialize': a database compiled by 'mesos-compile-credentials'
+  // and a credentials file which gets reread every 'reloadInterval',
+  // zero disables rereading it.
+  void prepare(const Option<std::string>& databasePath_,
+               const Option<std::string>& credentialsPath_,
+               const Duration& reloadInterval_);
+
   virtual Try<Nothing> initialize(const Option<Credentials>& credentials);
 
   virtual process::Future<Option<std::string>> authenticate(
@@ -53,10 +68,21 @@ public:
 
 private:
   CRAMMD5AuthenticatorProcess* process;
+
+  // The credentials of this authenticator, served through their own
+  // auxiliary property plugin named 'auxprop'.
+  std::shared_ptr<PropertyStore> store;
+  std::string auxprop;
+
+  CredentialsWatcher* watcher;
+
+  Option<std::string> databasePath;
+  Option<std::string> credentialsPath;
+  Duration reloadInterval;
 };
 
 } // namespace cram_md5 {
-} // namespace internal {
+} // namespace modules {
 } // namespace mesos {
 
 #endif //__AUTHENTICATION_CRAM_MD5_AUTHENTICATOR_HPP__
@@ -18,21 +18,85 @@
 
 #include "authentication/cram_md5/auxprop.hpp"
 
-#include <mutex>
+#include <string.h>
 
-using std::list;
+#include <memory>
+
+#include <glog/logging.h>
+
+#include <process/future.hpp>
+
+#include <stout/error.hpp>
+#include <stout/nothing.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/synchronized.hpp>
+
+#include "authentication/cram_md5/metrics.hpp"
+
+using std::shared_ptr;
+using std::unique_ptr;
 using std::string;
 
 namespace mesos {
-namespace internal {
+namespace modules {
 namespace cram_md5 {
 
 // Storage for the static members.
-Multimap<string, Property> InMemoryAuxiliaryPropertyPlugin::properties;
-sasl_auxprop_plug_t InMemoryAuxiliaryPropertyPlugin::plugin;
+shared_ptr<PropertyStore> InMemoryAuxiliaryPropertyPlugin::store(
+    new PropertyStore());
+std::map<string, shared_ptr<InMemoryAuxiliaryPropertyPlugin::Namespace>>
+  InMemoryAuxiliaryPropertyPlugin::namespaces;
 std::mutex InMemoryAuxiliaryPropertyPlugin::mutex;
 
 
+Try<Nothing> InMemoryAuxiliaryPropertyPlugin::attach(
+    const string& name,
+    const shared_ptr<PropertyStore>& _store)
+{
+  synchronized (mutex) {
+    if (namespaces.count(name) > 0) {
+      std::atomic_store(&namespaces[name]->store, _store);
+      return Nothing();
+    }
+
+    shared_ptr<Namespace> _namespace(new Namespace());
+    _namespace->name = name;
+    _namespace->store = _store;
+
+    namespaces[name] = _namespace;
+  }
+
+  // Not holding the lock here as adding the plugin calls back into
+  // 'initialize'.
+  int result = sasl_auxprop_add_plugin(
+      name.c_str(),
+      &InMemoryAuxiliaryPropertyPlugin::initialize);
+
+  if (result != SASL_OK) {
+    synchronized (mutex) {
+      namespaces.erase(name);
+    }
+
+    return Error(
+        "Failed to add auxiliary property plugin '" + name + "': " +
+        sasl_errstring(result, NULL, NULL));
+  }
+
+  return Nothing();
+}
+
+
+void InMemoryAuxiliaryPropertyPlugin::detach(const string& name)
+{
+  synchronized (mutex) {
+    if (namespaces.count(name) > 0) {
+      shared_ptr<PropertyStore> empty(new PropertyStore(1));
+      std::atomic_store(&namespaces[name]->store, empty);
+    }
+  }
+}
+
+
 int InMemoryAuxiliaryPropertyPlugin::initialize(
     const sasl_utils_t* utils,
     int api,
@@ -51,17 +115,40 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
 
   *version = SASL_AUXPROP_PLUG_VERSION;
 
+  if (name == NULL) {
+    name = InMemoryAuxiliaryPropertyPlugin::name();
+  }
+
+  shared_ptr<Namespace> _namespace;
+
+  synchronized (mutex) {
+    // Plugins which were added without getting attached to a store
+    // before, e.g., the default one, serve the default store.
+    if (namespaces.count(name) == 0) {
+      shared_ptr<Namespace> created(new Namespace());
+      created->name = name;
+      created->store = store;
+
+      namespaces[name] = created;
+    }
+
+    _namespace = namespaces[name];
+  }
+
+  sasl_auxprop_plug_t& plugin = _namespace->plugin;
+
   plugin.features = 0;
   plugin.spare_int1 = 0;
-  plugin.glob_context = NULL;
+  plugin.glob_context = _namespace.get();
   plugin.auxprop_free = NULL;
   plugin.auxprop_lookup = &InMemoryAuxiliaryPropertyPlugin::lookup;
-  plugin.name = const_cast<char*>(InMemoryAuxiliaryPropertyPlugin::name());
+  plugin.name = const_cast<char*>(_namespace->name.c_str());
   plugin.auxprop_store = NULL;
 
   *plug = &plugin;
 
-  VLOG(1) << "Initialized in-memory auxiliary property plugin";
+  VLOG(1) << "Initialized in-memory auxiliary property plugin '"
+          << name << "'";
 
   return SASL_OK;
 }
@@ -78,6 +165,21 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
     const char* user,
     unsigned length)
 {
+  // NULL unless metrics got enabled.
+  Metrics* metrics = Metrics::get();
+
+  Stopwatch stopwatch;
+  unique_ptr<process::Promise<Nothing>> latency;
+  if (metrics != NULL) {
+    ++metrics->lookups;
+    stopwatch.start();
+
+    if (Metrics::sample()) {
+      latency.reset(new process::Promise<Nothing>());
+      metrics->lookup_latency.time(latency->future());
+    }
+  }
+
   // Pull out the utils.
   const sasl_utils_t* utils = sparams->utils;
 
@@ -90,15 +192,33 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
   CHECK(properties != NULL)
     << "Invalid auxiliary properties requested for lookup";
 
+  // The plugin's 'glob_context' tells us which store to look in.
+  const Namespace* _namespace = static_cast<const Namespace*>(context);
+
+  CHECK(_namespace != NULL)
+    << "Missing context for auxiliary property plugin";
+
+  // Hold on to the user's current shard and the database for the
+  // duration of this call, all values we hand to 'prop_set' point
+  // into either of them.
+  shared_ptr<PropertyStore> _store = std::atomic_load(&_namespace->store);
+  shared_ptr<const PropertyTable> table = _store->shard(user, length);
+  shared_ptr<const CredentialDatabase> database = _store->database();
+
+  // Users in memory, including tombstones, hide the database.
+  if (database.get() != NULL && table->contains(user, length)) {
+    database.reset();
+  }
+
   // TODO(benh): Consider "parsing" 'user' if it has an '@' separating
   // the actual user and a realm.
 
-  string realm = sparams->user_realm != NULL
+  const char* realm = sparams->user_realm != NULL
     ? sparams->user_realm
     : sparams->serverFQDN;
 
   VLOG(1)
-    << "Request to lookup properties for "
+    << "Request to lookup properties in '" << _namespace->name << "' for "
     << "user: '" << user << "' "
     << "realm: '" << realm << "' "
     << "server FQDN: '" << sparams->serverFQDN << "' "
@@ -121,6 +241,9 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
       if (name[0] == '*') {
         VLOG(1) << "Skipping auxiliary property '" << name
                 << "' since SASL_AUXPROP_AUTHZID == true";
+        if (metrics != NULL) {
+          ++metrics->skipped;
+        }
         continue;
       }
     } else {
@@ -131,6 +254,9 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
         VLOG(1) << "Skipping auxiliary property '" << name
                 << "' since SASL_AUXPROP_AUTHZID == false "
                 << "but property name starts with '*'";
+        if (metrics != NULL) {
+          ++metrics->skipped;
+        }
         continue;
       } else {
         name = name + 1;
@@ -145,21 +271,30 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
       // SASL_AUXPROP_VERIFY_AGAINST_HASH flag is set, so we erase it
       // here.
       if (flags & SASL_AUXPROP_VERIFY_AGAINST_HASH &&
-          string(name) == string(SASL_AUX_PASSWORD_PROP)) {
+          strcmp(name, SASL_AUX_PASSWORD_PROP) == 0) {
         VLOG(1) << "Erasing auxiliary property '" << name
                 << "' even though SASL_AUXPROP_OVERRIDE == true "
                 << "since SASL_AUXPROP_VERIFY_AGAINST_HASH == true";
         utils->prop_erase(sparams->propctx, property->name);
+        if (metrics != NULL) {
+          ++metrics->erased;
+        }
       } else {
         VLOG(1) << "Skipping auxiliary property '" << name
                 << "' since SASL_AUXPROP_OVERRIDE == false "
                 << "and value(s) already set";
+        if (metrics != NULL) {
+          ++metrics->skipped;
+        }
         continue;
       }
 #else
       VLOG(1) << "Skipping auxiliary property '" << name
               << "' since SASL_AUXPROP_OVERRIDE == false "
               << "and value(s) already set";
+      if (metrics != NULL) {
+        ++metrics->skipped;
+      }
       continue;
 #endif
     } else if (property->values != NULL) {
@@ -167,14 +302,30 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
       VLOG(1) << "Erasing auxiliary property '" << name
               << "' since SASL_AUXPROP_OVERRIDE == true";
       utils->prop_erase(sparams->propctx, property->name);
+      if (metrics != NULL) {
+        ++metrics->erased;
+      }
     }
 
     VLOG(1) << "Looking up auxiliary property '" << property->name << "'";
 
-    Option<list<string> > values = lookup(user, name);
+    const size_t nameLength = strlen(name);
+
+    const PropertyValues* values = table->find(user, length, name, nameLength);
+
+    PropertyValues mapped;
+    if (values == NULL &&
+        database.get() != NULL &&
+        database->find(user, length, name, nameLength, &mapped)) {
+      values = &mapped;
+    }
 
-    if (values.isSome()) {
-      if (values.get().empty()) {
+    if (values == NULL) {
+      if (metrics != NULL) {
+        ++metrics->misses;
+      }
+    } else {
+      if (values->empty()) {
         // Add the 'NULL' value to indicate there were no values.
         utils->prop_set(sparams->propctx, property->name, NULL, 0);
       } else {
@@ -183,23 +334,33 @@ int InMemoryAuxiliaryPropertyPlugin::initialize(
         // the previous 'prop_set' calls which is the behavior we want
         // after adding the first value.
         bool append = false;
-        foreach (const string& value, values.get()) {
+        for (const PropertyValue* value = values->begin;
+             value != values->end;
+             ++value) {
           sparams->utils->prop_set(
               sparams->propctx,
               append ? NULL : property->name,
-              value.c_str(),
-              -1); // Let 'prop_set' use strlen.
+              values->data(*value),
+              static_cast<int>(value->length));
           append = true;
         }
       }
     }
   }
 
+  if (metrics != NULL) {
+    metrics->lookup_ns += stopwatch.elapsed().ns();
+
+    if (latency) {
+      latency->set(Nothing());
+    }
+  }
+
 #if SASL_AUXPROP_PLUG_VERSION > 4
   return SASL_OK;
 #endif
 }
 
 } // namespace cram_md5 {
-} // namespace internal {
+} // namespace modules {
 } // namespace mesos {
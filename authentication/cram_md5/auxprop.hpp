@@ -19,58 +19,82 @@
 #ifndef __AUTHENTICATION_CRAM_MD5_AUXPROP_HPP__
 #define __AUTHENTICATION_CRAM_MD5_AUXPROP_HPP__
 
+#include <list>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 
 #include <sasl/sasl.h>
 #include <sasl/saslplug.h>
 
-#include <stout/foreach.hpp>
 #include <stout/multimap.hpp>
-#include <stout/none.hpp>
-#include <stout/option.hpp>
-#include <stout/synchronized.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/credential_database.hpp"
+#include "authentication/cram_md5/property_store.hpp"
+#include "authentication/cram_md5/property_table.hpp"
 
 namespace mesos {
-namespace internal {
+namespace modules {
 namespace cram_md5 {
 
-struct Property
-{
-  std::string name;
-  std::list<std::string> values;
-};
-
-
+// Note that libmesos has an auxiliary property plugin of the same
+// name in 'mesos::internal::cram_md5'; this one lives in
+// 'mesos::modules' so that the dynamic linker does not resolve the
+// symbols of either to the other, e.g., when adding the plugin
+// through 'sasl_auxprop_add_plugin'.
 class InMemoryAuxiliaryPropertyPlugin
 {
 public:
   static const char* name() { return "in-memory-auxprop"; }
 
-  static void load(const Multimap<std::string, Property>& _properties)
+  // The following operate on the default store, served under 'name()'.
+  static void load(const Multimap<std::string, Property>& properties)
   {
-    synchronized (mutex) {
-      properties = _properties;
-    }
+    store->load(properties);
   }
 
-  static Option<std::list<std::string>> lookup(
+  // Replaces the properties of a single user, e.g., for rotating its
+  // secret without reloading all credentials.
+  static void upsert(
       const std::string& user,
-      const std::string& name)
+      const std::list<Property>& properties)
+  {
+    store->upsert(user, properties);
+  }
+
+  static void remove(const std::string& user)
+  {
+    store->remove(user);
+  }
+
+  // Serves the users of a compiled credential database, see
+  // 'mesos-compile-credentials'.
+  static void mount(const std::shared_ptr<const CredentialDatabase>& database)
   {
-    synchronized (mutex) {
-      if (properties.contains(user)) {
-        foreach (const Property& property, properties.get(user)) {
-          if (property.name == name) {
-            return property.values;
-          }
-        }
-      }
-    }
-
-    return None();
+    store->mount(database);
   }
 
+  static PropertyStore* properties() { return store.get(); }
+
+  // Serves 'store' through an additional auxiliary property plugin
+  // named 'name', allowing multiple authenticators to keep separate
+  // credentials. SASL connections pick a store by setting the
+  // 'auxprop_plugin' option to its name, e.g., through a per
+  // connection SASL_CB_GETOPT callback. Attaching to a name that is
+  // in use already replaces its store. Must be called after
+  // 'sasl_server_init'.
+  static Try<Nothing> attach(
+      const std::string& name,
+      const std::shared_ptr<PropertyStore>& store);
+
+  // Stops serving the store attached as 'name'. Note that SASL does
+  // not support removing plugins, lookups through 'name' will not
+  // find any properties from here on.
+  static void detach(const std::string& name);
+
   // SASL plugin initialize entry.
   static int initialize(
       const sasl_utils_t* utils,
@@ -80,6 +104,18 @@ public:
       const char* name);
 
 private:
+  // A store served under a plugin name; the address of a namespace
+  // is the 'glob_context' handed to 'lookup'.
+  struct Namespace
+  {
+    std::string name;
+
+    // Only accessed through 'std::atomic_load' and 'std::atomic_store'.
+    std::shared_ptr<PropertyStore> store;
+
+    sasl_auxprop_plug_t plugin;
+  };
+
 #if SASL_AUXPROP_PLUG_VERSION <= 4
   static void lookup(
 #else
@@ -91,19 +127,19 @@ private:
       const char* user,
       unsigned length);
 
-  // TODO(tillt): For allowing multiple authenticators with differing
-  // credentials, consider using a non-static credential properties.
-  static Multimap<std::string, Property> properties;
+  // The store behind the default plugin name.
+  static std::shared_ptr<PropertyStore> store;
 
-  static sasl_auxprop_plug_t plugin;
+  // Namespaces never get erased as SASL may hold on to their plugin
+  // for the lifetime of the process.
+  static std::map<std::string, std::shared_ptr<Namespace>> namespaces;
 
-  // Access to 'properties' has to be protected as multiple
-  // authenticator instances may be active concurrently.
+  // Protects 'namespaces'; lookups do not take it.
   static std::mutex mutex;
 };
 
 } // namespace cram_md5 {
-} // namespace internal {
+} // namespace modules {
 } // namespace mesos {
 
 #endif // __AUTHENTICATION_CRAM_MD5_AUXPROP_HPP__
@@ -0,0 +1,91 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compiles a credentials file, in any of the formats accepted by the
+// '--credentials' flag, into a database which the in-memory auxiliary
+// property plugin maps instead of parsing credentials at startup.
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/credential_database.hpp"
+#include "authentication/cram_md5/credentials.hpp"
+
+using namespace mesos::modules::cram_md5;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+
+int main(int argc, char** argv)
+{
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " <credentials> <database>" << endl;
+    return EXIT_FAILURE;
+  }
+
+  const string path = argv[1];
+  const string output = argv[2];
+
+  Try<string> read = os::read(path);
+  if (read.isError()) {
+    cerr << "Failed to read credentials from '" << path << "': "
+         << read.error() << endl;
+    return EXIT_FAILURE;
+  }
+
+  Try<hashmap<string, string>> secrets = credentials::parse(read.get());
+  if (secrets.isError()) {
+    cerr << "Failed to parse credentials from '" << path << "': "
+         << secrets.error() << endl;
+    return EXIT_FAILURE;
+  }
+
+  const string database =
+    CredentialDatabase::compile(credentials::properties(secrets.get()));
+
+  // Write to a temporary file first and rename it into place; masters
+  // which have the previous database mapped keep reading that one.
+  const string temporary = output + ".tmp";
+
+  Try<Nothing> write = os::write(temporary, database);
+  if (write.isError()) {
+    cerr << "Failed to write '" << temporary << "': " << write.error() << endl;
+    return EXIT_FAILURE;
+  }
+
+  Try<Nothing> rename = os::rename(temporary, output);
+  if (rename.isError()) {
+    cerr << "Failed to rename '" << temporary << "' to '" << output << "': "
+         << rename.error() << endl;
+    return EXIT_FAILURE;
+  }
+
+  cout << "Compiled " << secrets.get().size() << " credentials into '"
+       << output << "'" << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,329 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "authentication/cram_md5/credential_database.hpp"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <vector>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
+#include <stout/stringify.hpp>
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+namespace {
+
+const char MAGIC[8] = { 'M', 'E', 'S', 'O', 'S', 'C', 'D', 'B' };
+const uint32_t VERSION = 1;
+const uint32_t ORDER = 0x01020304;
+
+
+// Rounds 'length' up to the section alignment.
+uint64_t align(uint64_t length)
+{
+  return (length + 7) & ~static_cast<uint64_t>(7);
+}
+
+
+template <typename T>
+void append(string* buffer, const T* data, size_t count)
+{
+  buffer->append(reinterpret_cast<const char*>(data), sizeof(T) * count);
+}
+
+} // namespace {
+
+
+Try<CredentialDatabase*> CredentialDatabase::open(const string& path)
+{
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return ErrnoError("Failed to open '" + path + "'");
+  }
+
+  struct stat s;
+  if (::fstat(fd, &s) < 0) {
+    ErrnoError error("Failed to stat '" + path + "'");
+    ::close(fd);
+    return error;
+  }
+
+  const size_t length = s.st_size;
+  if (length < sizeof(Header)) {
+    ::close(fd);
+    return Error("Truncated credential database '" + path + "'");
+  }
+
+  void* data = ::mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+
+  // The mapping stays valid after closing the file descriptor.
+  ::close(fd);
+
+  if (data == MAP_FAILED) {
+    return ErrnoError("Failed to map '" + path + "'");
+  }
+
+  CredentialDatabase* database =
+    new CredentialDatabase(static_cast<const char*>(data), length);
+
+  Try<Nothing> validate = database->validate();
+  if (validate.isError()) {
+    delete database;
+    return Error(
+        "Invalid credential database '" + path + "': " + validate.error());
+  }
+
+  return database;
+}
+
+
+string CredentialDatabase::compile(const Multimap<string, Property>& properties)
+{
+  vector<Entry> entries;
+  vector<PropertyValue> values;
+  string strings;
+
+  // Like a PropertyTable, the first property of a given name wins.
+  hashset<string> keys;
+
+  foreachpair (const string& user, const Property& property, properties) {
+    if (!keys.insert(user + '\0' + property.name).second) {
+      continue;
+    }
+
+    Entry entry;
+    entry.hash = PropertyTable::hash(
+        user.data(), user.size(), property.name.data(), property.name.size());
+
+    entry.user = strings.size();
+    entry.userLength = user.size();
+    strings.append(user.c_str(), user.size() + 1);
+
+    entry.name = strings.size();
+    entry.nameLength = property.name.size();
+    strings.append(property.name.c_str(), property.name.size() + 1);
+
+    entry.firstValue = values.size();
+    entry.valueCount = property.values.size();
+    foreach (const string& value, property.values) {
+      PropertyValue _value;
+      _value.offset = strings.size();
+      _value.length = value.size();
+      values.push_back(_value);
+
+      strings.append(value.c_str(), value.size() + 1);
+    }
+
+    entries.push_back(entry);
+  }
+
+  uint64_t slotCount = 1;
+  while (slotCount < entries.size() * 2) {
+    slotCount <<= 1;
+  }
+
+  vector<uint64_t> slots(slotCount, 0);
+  for (size_t i = 0; i < entries.size(); i++) {
+    uint64_t slot = entries[i].hash & (slotCount - 1);
+    while (slots[slot] != 0) {
+      slot = (slot + 1) & (slotCount - 1);
+    }
+    slots[slot] = i + 1;
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.order = ORDER;
+  header.slotCount = slotCount;
+  header.entryCount = entries.size();
+  header.valueCount = values.size();
+  header.stringsLength = strings.size();
+  header.slots = align(sizeof(Header));
+  header.entries = header.slots + sizeof(uint64_t) * slotCount;
+  header.values = header.entries + sizeof(Entry) * entries.size();
+  header.strings = header.values + sizeof(PropertyValue) * values.size();
+
+  string result;
+  result.reserve(header.strings + strings.size());
+
+  append(&result, &header, 1);
+  result.resize(header.slots, '\0');
+  append(&result, slots.data(), slots.size());
+  append(&result, entries.data(), entries.size());
+  append(&result, values.data(), values.size());
+  result.append(strings);
+
+  return result;
+}
+
+
+CredentialDatabase::CredentialDatabase(const char* _data, size_t _length)
+  : data(_data),
+    length(_length),
+    header(reinterpret_cast<const Header*>(_data)),
+    slots(NULL),
+    entries(NULL),
+    values(NULL),
+    strings(NULL) {}
+
+
+CredentialDatabase::~CredentialDatabase()
+{
+  ::munmap(const_cast<char*>(data), length);
+}
+
+
+bool CredentialDatabase::find(
+    const char* user,
+    size_t userLength,
+    const char* name,
+    size_t nameLength,
+    PropertyValues* result) const
+{
+  if (header->entryCount == 0) {
+    return false;
+  }
+
+  const uint64_t hash = PropertyTable::hash(user, userLength, name, nameLength);
+  const uint64_t mask = header->slotCount - 1;
+
+  // Bound the probing so that a corrupt, full index cannot loop.
+  uint64_t slot = hash & mask;
+  for (uint64_t probe = 0;
+       probe < header->slotCount && slots[slot] != 0;
+       probe++, slot = (slot + 1) & mask) {
+    const uint64_t index = slots[slot] - 1;
+    if (index >= header->entryCount) {
+      return false;
+    }
+
+    const Entry& entry = entries[index];
+    if (entry.hash != hash ||
+        entry.userLength != userLength ||
+        entry.nameLength != nameLength ||
+        !contains(entry.user, userLength) ||
+        !contains(entry.name, nameLength) ||
+        memcmp(strings + entry.user, user, userLength) != 0 ||
+        memcmp(strings + entry.name, name, nameLength) != 0) {
+      continue;
+    }
+
+    if (entry.firstValue > header->valueCount ||
+        entry.valueCount > header->valueCount - entry.firstValue) {
+      return false;
+    }
+
+    const PropertyValue* begin = values + entry.firstValue;
+    const PropertyValue* end = begin + entry.valueCount;
+
+    for (const PropertyValue* value = begin; value != end; ++value) {
+      if (!contains(value->offset, value->length)) {
+        return false;
+      }
+    }
+
+    result->base = strings;
+    result->begin = begin;
+    result->end = end;
+    return true;
+  }
+
+  return false;
+}
+
+
+size_t CredentialDatabase::size() const
+{
+  return header->entryCount;
+}
+
+
+Try<Nothing> CredentialDatabase::validate()
+{
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+    return Error("Bad magic");
+  }
+
+  if (header->order != ORDER) {
+    return Error("Unsupported byte order");
+  }
+
+  if (header->version != VERSION) {
+    return Error("Unsupported version " + stringify(header->version));
+  }
+
+  if (header->slotCount == 0 ||
+      (header->slotCount & (header->slotCount - 1)) != 0) {
+    return Error("Slot count is not a power of two");
+  }
+
+  // Make sure every section lies within the mapping; the counts are
+  // bounded by the length first so that the products cannot overflow.
+  struct Section { uint64_t offset; uint64_t count; uint64_t size; };
+
+  const Section sections[] = {
+    { header->slots, header->slotCount, sizeof(uint64_t) },
+    { header->entries, header->entryCount, sizeof(Entry) },
+    { header->values, header->valueCount, sizeof(PropertyValue) },
+    { header->strings, header->stringsLength, 1 }
+  };
+
+  foreach (const Section& section, sections) {
+    if (section.offset % 8 != 0 ||
+        section.offset < sizeof(Header) ||
+        section.offset > length ||
+        section.count > length ||
+        section.count * section.size > length - section.offset) {
+      return Error("Section out of bounds");
+    }
+  }
+
+  slots = reinterpret_cast<const uint64_t*>(data + header->slots);
+  entries = reinterpret_cast<const Entry*>(data + header->entries);
+  values = reinterpret_cast<const PropertyValue*>(data + header->values);
+  strings = data + header->strings;
+
+  return Nothing();
+}
+
+
+bool CredentialDatabase::contains(uint64_t offset, uint64_t size) const
+{
+  return offset <= header->stringsLength &&
+    size <= header->stringsLength - offset;
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
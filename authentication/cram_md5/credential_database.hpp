@@ -0,0 +1,122 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AUTHENTICATION_CRAM_MD5_CREDENTIAL_DATABASE_HPP__
+#define __AUTHENTICATION_CRAM_MD5_CREDENTIAL_DATABASE_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include <stout/multimap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/property_table.hpp"
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+// Immutable, memory mapped counterpart of a PropertyTable. The file
+// holds a precomputed open addressed hash index plus all users, names
+// and values, so opening it costs the same regardless of how many
+// credentials it contains and lookups read straight from the mapping.
+//
+// Layout, in host byte order and with every section 8 byte aligned:
+//   Header
+//   uint64_t slots[slotCount]      (entry index plus one, zero if empty)
+//   Entry entries[entryCount]
+//   PropertyValue values[valueCount]
+//   char strings[stringsLength]    (users, names and values)
+class CredentialDatabase
+{
+public:
+  // Maps the database stored at 'path'.
+  static Try<CredentialDatabase*> open(const std::string& path);
+
+  // Returns the serialized database holding 'properties'.
+  static std::string compile(const Multimap<std::string, Property>& properties);
+
+  ~CredentialDatabase();
+
+  // Looks up the values of property 'name' for 'user'. Returns false
+  // if there is no such user or property.
+  bool find(
+      const char* user,
+      size_t userLength,
+      const char* name,
+      size_t nameLength,
+      PropertyValues* values) const;
+
+  size_t size() const;
+
+private:
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;     // Detects a database of foreign byte order.
+    uint64_t slotCount; // Always a power of two.
+    uint64_t entryCount;
+    uint64_t valueCount;
+    uint64_t stringsLength;
+    uint64_t slots;     // Offsets of the sections from the start.
+    uint64_t entries;
+    uint64_t values;
+    uint64_t strings;
+  };
+
+  struct Entry
+  {
+    uint64_t hash;
+    uint64_t user;      // Offsets into the strings section.
+    uint64_t userLength;
+    uint64_t name;
+    uint64_t nameLength;
+    uint64_t firstValue;
+    uint64_t valueCount;
+  };
+
+  CredentialDatabase(const char* data, size_t length);
+
+  CredentialDatabase(const CredentialDatabase&);
+  CredentialDatabase& operator=(const CredentialDatabase&);
+
+  // Checks the header and sets up the section pointers.
+  Try<Nothing> validate();
+
+  // Whether [offset, offset + size) lies within the strings.
+  bool contains(uint64_t offset, uint64_t size) const;
+
+  const char* data;
+  const size_t length;
+
+  const Header* header;
+  const uint64_t* slots;
+  const Entry* entries;
+  const PropertyValue* values;
+  const char* strings;
+};
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_CRAM_MD5_CREDENTIAL_DATABASE_HPP__
@@ -0,0 +1,145 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AUTHENTICATION_CRAM_MD5_CREDENTIALS_HPP__
+#define __AUTHENTICATION_CRAM_MD5_CREDENTIALS_HPP__
+
+#include <stddef.h>   // For size_t needed by sasl.h.
+
+#include <string>
+#include <vector>
+
+#include <sasl/sasl.h>
+
+// The HMAC-MD5 helpers exported by libsasl2 (these headers need to be
+// included in this order).
+extern "C" {
+#include <sasl/md5global.h>
+#include <sasl/md5.h>
+#include <sasl/hmac-md5.h>
+}
+
+#include <mesos/mesos.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/json.hpp>
+#include <stout/multimap.hpp>
+#include <stout/protobuf.hpp>
+#include <stout/strings.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/property_table.hpp"
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+namespace credentials {
+
+// The auxiliary property from which the Cyrus SASL CRAM-MD5 mechanism
+// takes the HMAC-MD5 inner and outer pad state (an HMAC_MD5_STATE)
+// when there is no plaintext 'userPassword'.
+const char CRAM_MD5_SECRET_PROP[] = "cmusaslsecretCRAM-MD5";
+
+// Parses credentials in either of the formats accepted by the
+// '--credentials' flag: a JSON 'Credentials' object or lines of
+// whitespace separated principal and secret. Returns the secrets
+// keyed by principal.
+inline Try<hashmap<std::string, std::string>> parse(const std::string& contents)
+{
+  hashmap<std::string, std::string> result;
+
+  Try<JSON::Object> json = JSON::parse<JSON::Object>(contents);
+  if (json.isSome()) {
+    Try<Credentials> credentials = ::protobuf::parse<Credentials>(json.get());
+    if (credentials.isError()) {
+      return Error("Invalid credentials: " + credentials.error());
+    }
+
+    foreach (const Credential& credential, credentials.get().credentials()) {
+      result[credential.principal()] = credential.secret();
+    }
+
+    return result;
+  }
+
+  foreach (const std::string& line, strings::tokenize(contents, "\n")) {
+    const std::vector<std::string> pairs = strings::tokenize(line, " \t");
+    if (pairs.size() != 2) {
+      return Error("Invalid credential format at line: " + line);
+    }
+    result[pairs[0]] = pairs[1];
+  }
+
+  return result;
+}
+
+
+// Returns the auxiliary property carrying the precomputed CRAM-MD5
+// secret for a principal's plaintext secret. Precomputing spares each
+// handshake the key schedule and keeps the plaintext out of memory.
+inline Property secret(const std::string& secret)
+{
+  HMAC_MD5_STATE state;
+  hmac_md5_precalc(
+      &state,
+      reinterpret_cast<const unsigned char*>(secret.data()),
+      static_cast<int>(secret.size()));
+
+  Property property;
+  property.name = CRAM_MD5_SECRET_PROP;
+  property.values.push_back(
+      std::string(reinterpret_cast<const char*>(&state), sizeof(state)));
+
+  return property;
+}
+
+
+// Replaces a plaintext 'userPassword' property by the corresponding
+// precomputed CRAM-MD5 secret, returns any other property unchanged.
+inline Property precompute(const Property& property)
+{
+  if (property.name != SASL_AUX_PASSWORD_PROP || property.values.empty()) {
+    return property;
+  }
+
+  return secret(property.values.front());
+}
+
+
+inline Multimap<std::string, Property> properties(
+    const hashmap<std::string, std::string>& secrets)
+{
+  Multimap<std::string, Property> result;
+
+  foreachpair (const std::string& principal,
+               const std::string& secret,
+               secrets) {
+    result.put(principal, credentials::secret(secret));
+  }
+
+  return result;
+}
+
+} // namespace credentials {
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_CRAM_MD5_CREDENTIALS_HPP__
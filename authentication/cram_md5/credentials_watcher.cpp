@@ -0,0 +1,153 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "authentication/cram_md5/credentials_watcher.hpp"
+
+#include <list>
+#include <string>
+
+#include <process/delay.hpp>
+#include <process/id.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/credentials.hpp"
+
+using namespace process;
+
+using std::list;
+using std::string;
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+class CredentialsWatcherProcess : public Process<CredentialsWatcherProcess>
+{
+public:
+  CredentialsWatcherProcess(
+      const string& _path,
+      const Duration& _interval,
+      PropertyStore* _store)
+    : ProcessBase(ID::generate("cram_md5_credentials_watcher")),
+      path(_path),
+      interval(_interval),
+      store(_store) {}
+
+  virtual ~CredentialsWatcherProcess() {}
+
+protected:
+  virtual void initialize()
+  {
+    check();
+  }
+
+private:
+  void check()
+  {
+    Try<string> read = os::read(path);
+
+    if (read.isError()) {
+      LOG(WARNING) << "Failed to read credentials from '" << path << "': "
+                   << read.error();
+    } else {
+      Try<hashmap<string, string>> parsed = credentials::parse(read.get());
+
+      if (parsed.isError()) {
+        LOG(WARNING) << "Failed to parse credentials from '" << path << "': "
+                     << parsed.error();
+      } else {
+        apply(parsed.get());
+      }
+    }
+
+    if (interval > Duration::zero()) {
+      delay(interval, self(), &Self::check);
+    }
+  }
+
+  void apply(const hashmap<string, string>& plaintexts)
+  {
+    size_t updated = 0;
+    size_t removed = 0;
+
+    hashmap<string, string> _secrets;
+
+    foreachpair (const string& principal,
+                 const string& plaintext,
+                 plaintexts) {
+      const Property secret = credentials::secret(plaintext);
+      _secrets[principal] = secret.values.front();
+
+      if (!secrets.contains(principal) ||
+          secrets.at(principal) != _secrets[principal]) {
+        store->upsert(principal, list<Property>(1, secret));
+        updated++;
+      }
+    }
+
+    foreachkey (const string& principal, secrets) {
+      if (!_secrets.contains(principal)) {
+        store->remove(principal);
+        removed++;
+      }
+    }
+
+    secrets = _secrets;
+
+    if (updated > 0 || removed > 0) {
+      LOG(INFO) << "Applied credentials from '" << path << "': "
+                << updated << " added or updated, " << removed << " removed";
+    }
+  }
+
+  const string path;
+  const Duration interval;
+  PropertyStore* store;
+
+  // The precomputed secrets of the last successfully applied file
+  // contents, which every read gets compared against; we do not hold
+  // on to any plaintext secrets.
+  hashmap<string, string> secrets;
+};
+
+
+CredentialsWatcher::CredentialsWatcher(
+    const string& path,
+    const Duration& interval,
+    PropertyStore* store)
+{
+  process = new CredentialsWatcherProcess(path, interval, store);
+  spawn(process);
+}
+
+
+CredentialsWatcher::~CredentialsWatcher()
+{
+  terminate(process);
+  wait(process);
+  delete process;
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
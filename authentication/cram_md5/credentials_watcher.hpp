@@ -0,0 +1,59 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AUTHENTICATION_CRAM_MD5_CREDENTIALS_WATCHER_HPP__
+#define __AUTHENTICATION_CRAM_MD5_CREDENTIALS_WATCHER_HPP__
+
+#include <string>
+
+#include <stout/duration.hpp>
+
+#include "authentication/cram_md5/property_store.hpp"
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+// Forward declaration.
+class CredentialsWatcherProcess;
+
+
+// Periodically rereads a credentials file, in any of the formats
+// accepted by the '--credentials' flag, and applies the differences
+// to a property store: only principals which got added, removed or
+// whose secret changed since the last read get updated. An interval
+// of zero reads the file only once.
+class CredentialsWatcher
+{
+public:
+  CredentialsWatcher(
+      const std::string& path,
+      const Duration& interval,
+      PropertyStore* store);
+
+  ~CredentialsWatcher();
+
+private:
+  CredentialsWatcherProcess* process;
+};
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_CRAM_MD5_CREDENTIALS_WATCHER_HPP__
@@ -0,0 +1,66 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "authentication/cram_md5/metrics.hpp"
+
+#include <mutex>
+
+#include <process/metrics/metrics.hpp>
+
+#include <stout/synchronized.hpp>
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+std::atomic<Metrics*> Metrics::instance(NULL);
+
+
+Metrics::Metrics()
+  : lookups("cram_md5_auxprop/lookups"),
+    misses("cram_md5_auxprop/misses"),
+    skipped("cram_md5_auxprop/skipped"),
+    erased("cram_md5_auxprop/erased"),
+    lookup_ns("cram_md5_auxprop/lookup_ns"),
+    lookup_latency("cram_md5_auxprop/lookup_latency_us"),
+    lock_wait_ns("cram_md5_auxprop/lock_wait_ns")
+{
+  process::metrics::add(lookups);
+  process::metrics::add(misses);
+  process::metrics::add(skipped);
+  process::metrics::add(erased);
+  process::metrics::add(lookup_ns);
+  process::metrics::add(lookup_latency);
+  process::metrics::add(lock_wait_ns);
+}
+
+
+void Metrics::enable()
+{
+  static std::mutex* mutex = new std::mutex();
+
+  synchronized (*mutex) {
+    if (instance.load() == NULL) {
+      instance.store(new Metrics(), std::memory_order_release);
+    }
+  }
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
@@ -0,0 +1,97 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AUTHENTICATION_CRAM_MD5_METRICS_HPP__
+#define __AUTHENTICATION_CRAM_MD5_METRICS_HPP__
+
+#include <atomic>
+
+#include <process/metrics/counter.hpp>
+#include <process/metrics/timer.hpp>
+
+#include <stout/duration.hpp>
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+// Metrics of the in-memory auxiliary property plugin and the property
+// stores behind it, exposed through the libprocess metrics endpoint
+// under 'cram_md5_auxprop/'. They are disabled by default: until
+// 'enable' got called 'get' returns NULL and callers skip all
+// accounting, leaving a single atomic load on the lookup path.
+//
+// Total durations get accumulated in nanoseconds, lookups typically
+// take less than a microsecond. Latencies are timed with 'Timer::time'
+// rather than 'Timer::start' and 'Timer::stop', the latter keep a
+// single stopwatch per timer while lookups run concurrently on
+// arbitrary threads.
+struct Metrics
+{
+  // Registers the metrics; calling it more than once has no effect.
+  static void enable();
+
+  static Metrics* get()
+  {
+    return instance.load(std::memory_order_acquire);
+  }
+
+  // Calls of the lookup entry point.
+  process::metrics::Counter lookups;
+
+  // Requested properties for which no values were found.
+  process::metrics::Counter misses;
+
+  // Requested properties skipped given the lookup flags.
+  process::metrics::Counter skipped;
+
+  // Values erased as they were about to be overridden.
+  process::metrics::Counter erased;
+
+  // Total time spent in lookups, in nanoseconds.
+  process::metrics::Counter lookup_ns;
+
+  // Latency of every 'SAMPLE_RATE'th lookup of a thread.
+  process::metrics::Timer<Microseconds> lookup_latency;
+
+  // Total time writers waited for a shard lock, in nanoseconds.
+  process::metrics::Counter lock_wait_ns;
+
+  static const unsigned SAMPLE_RATE = 64;
+
+  // Returns whether the calling thread's current lookup gets its
+  // latency timed. Keeps a count per thread so that sampling does not
+  // add contention on the lookup path.
+  static bool sample()
+  {
+    static thread_local unsigned lookups = 0;
+    return lookups++ % SAMPLE_RATE == 0;
+  }
+
+private:
+  Metrics();
+
+  // Never deleted, lookups may run until the process exits.
+  static std::atomic<Metrics*> instance;
+};
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_CRAM_MD5_METRICS_HPP__
@@ -0,0 +1,159 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "authentication/cram_md5/property_store.hpp"
+
+#include <atomic>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/synchronized.hpp>
+
+#include "authentication/cram_md5/credentials.hpp"
+#include "authentication/cram_md5/metrics.hpp"
+
+using std::list;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+PropertyStore::PropertyStore(size_t _shards)
+  : mutexes(_shards)
+{
+  CHECK_GT(_shards, 0u);
+
+  shared_ptr<const PropertyTable> empty(
+      new PropertyTable(Multimap<string, Property>()));
+
+  shards.assign(_shards, empty);
+}
+
+
+void PropertyStore::load(const Multimap<string, Property>& properties)
+{
+  vector<Multimap<string, Property>> partitions(shards.size());
+
+  foreachpair (const string& user, const Property& property, properties) {
+    partitions[index(user.data(), user.size())].put(
+        user, credentials::precompute(property));
+  }
+
+  Metrics* metrics = Metrics::get();
+
+  for (size_t i = 0; i < shards.size(); i++) {
+    shared_ptr<const PropertyTable> table(new PropertyTable(partitions[i]));
+
+    Stopwatch stopwatch;
+    if (metrics != NULL) {
+      stopwatch.start();
+    }
+
+    synchronized (mutexes[i]) {
+      if (metrics != NULL) {
+        metrics->lock_wait_ns += stopwatch.elapsed().ns();
+      }
+
+      std::atomic_store(&shards[i], table);
+    }
+  }
+}
+
+
+void PropertyStore::upsert(const string& user, const list<Property>& properties)
+{
+  update(user, properties);
+}
+
+
+void PropertyStore::remove(const string& user)
+{
+  // The marker 'update' leaves without any other properties makes a
+  // tombstone, see PropertyTable.
+  update(user, list<Property>());
+}
+
+
+void PropertyStore::mount(const shared_ptr<const CredentialDatabase>& database)
+{
+  std::atomic_store(&base, database);
+}
+
+
+shared_ptr<const PropertyTable> PropertyStore::shard(
+    const char* user,
+    size_t length) const
+{
+  return std::atomic_load(&shards[index(user, length)]);
+}
+
+
+shared_ptr<const CredentialDatabase> PropertyStore::database() const
+{
+  return std::atomic_load(&base);
+}
+
+
+size_t PropertyStore::index(const char* user, size_t length) const
+{
+  return fnv1a(user, length) % shards.size();
+}
+
+
+void PropertyStore::update(const string& user, const list<Property>& properties)
+{
+  const size_t i = index(user.data(), user.size());
+
+  Metrics* metrics = Metrics::get();
+
+  Stopwatch stopwatch;
+  if (metrics != NULL) {
+    stopwatch.start();
+  }
+
+  synchronized (mutexes[i]) {
+    if (metrics != NULL) {
+      metrics->lock_wait_ns += stopwatch.elapsed().ns();
+    }
+
+    Multimap<string, Property> partition =
+      std::atomic_load(&shards[i])->properties();
+
+    partition.remove(user);
+
+    // The marker hides the user in any database, also in one mounted
+    // later, even if no properties are left.
+    partition.put(user, Property());
+
+    foreach (const Property& property, properties) {
+      partition.put(user, credentials::precompute(property));
+    }
+
+    shared_ptr<const PropertyTable> table(new PropertyTable(partition));
+    std::atomic_store(&shards[i], table);
+  }
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
@@ -0,0 +1,111 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AUTHENTICATION_CRAM_MD5_PROPERTY_STORE_HPP__
+#define __AUTHENTICATION_CRAM_MD5_PROPERTY_STORE_HPP__
+
+#include <stddef.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <stout/multimap.hpp>
+
+#include "authentication/cram_md5/credential_database.hpp"
+#include "authentication/cram_md5/property_table.hpp"
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+// Properties of all users, sharded by a hash of the user name. Each
+// shard is an immutable PropertyTable which writers replace
+// atomically, hence readers never block. Updating a single user only
+// rebuilds the shard holding that user, so the cost of an update is
+// bounded by the shard size rather than by the number of users, and
+// writers touching different shards do not contend.
+//
+// Plaintext 'userPassword' properties are never stored; they get
+// replaced by the precomputed CRAM-MD5 secret on the way in.
+//
+// A store may additionally be backed by a CredentialDatabase which
+// serves all users that are not in memory. The database itself is
+// immutable: 'upsert' overrides all properties of one of its users,
+// none of the database properties of that user remain visible, and
+// 'remove' leaves a tombstone hiding the user. Both also hold for a
+// database mounted after the update.
+class PropertyStore
+{
+public:
+  static const size_t DEFAULT_SHARDS = 256;
+
+  explicit PropertyStore(size_t shards = DEFAULT_SHARDS);
+
+  // Replaces all in-memory properties, dropping any tombstones. Each
+  // user's properties get swapped in atomically, but a concurrent
+  // lookup may observe some users already updated while others are
+  // not yet.
+  void load(const Multimap<std::string, Property>& properties);
+
+  // Replaces all properties of 'user', adding the user if unknown.
+  void upsert(const std::string& user, const std::list<Property>& properties);
+
+  // Removes 'user' and all of its properties. The user is kept as a
+  // tombstone, hiding it in the database, mounted now or later, until
+  // it gets upserted again or the store reloaded.
+  void remove(const std::string& user);
+
+  // Serves the users of 'database' underneath the in-memory
+  // properties, replacing any previously mounted database.
+  void mount(const std::shared_ptr<const CredentialDatabase>& database);
+
+  // Returns the shard responsible for 'user'. Values found in it
+  // remain valid for as long as the returned reference is held.
+  std::shared_ptr<const PropertyTable> shard(
+      const char* user,
+      size_t length) const;
+
+  // Returns the mounted database, if any. Just like with shards,
+  // values found in it are valid while the reference is held.
+  std::shared_ptr<const CredentialDatabase> database() const;
+
+private:
+  size_t index(const char* user, size_t length) const;
+
+  // Updates the shard responsible for 'user' under its write lock.
+  void update(
+      const std::string& user,
+      const std::list<Property>& properties);
+
+  // Only accessed through 'std::atomic_load' and 'std::atomic_store'.
+  std::vector<std::shared_ptr<const PropertyTable>> shards;
+  std::shared_ptr<const CredentialDatabase> base;
+
+  // Serialize writers of the corresponding shard; readers do not
+  // take them.
+  std::vector<std::mutex> mutexes;
+};
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_CRAM_MD5_PROPERTY_STORE_HPP__
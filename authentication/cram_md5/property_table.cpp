@@ -0,0 +1,176 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "authentication/cram_md5/property_table.hpp"
+
+#include <string.h>
+
+#include <stout/foreach.hpp>
+
+using std::string;
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+PropertyTable::PropertyTable(const Multimap<string, Property>& properties)
+{
+  // Size the backing storage first; appending to 'buffer' and
+  // 'values' below must never reallocate. Each property may come
+  // with a marker for its user, hence users are accounted twice.
+  size_t length = 0;
+  size_t count = 0;
+  foreachpair (const string& user, const Property& property, properties) {
+    length += 2 * (user.size() + 1);
+    foreach (const string& value, property.values) {
+      length += value.size() + 1;
+      count++;
+    }
+  }
+
+  buffer.reserve(length);
+  values.reserve(count);
+  entries.reserve(properties.size() * 2);
+
+  size_t capacity = 1;
+  while (capacity < properties.size() * 4) {
+    capacity <<= 1;
+  }
+  slots.assign(capacity, 0);
+
+  foreachpair (const string& user, const Property& property, properties) {
+    if (!contains(user.data(), user.size())) {
+      insert(user, Property());
+    }
+
+    // Like a linear scan, the first property of a given name wins.
+    // Markers passed in get skipped here as well.
+    if (find(user.data(),
+             user.size(),
+             property.name.data(),
+             property.name.size()) != NULL) {
+      continue;
+    }
+
+    insert(user, property);
+  }
+}
+
+
+const PropertyValues* PropertyTable::find(
+    const char* user,
+    size_t userLength,
+    const char* name,
+    size_t nameLength) const
+{
+  if (entries.empty()) {
+    return NULL;
+  }
+
+  const uint64_t _hash = hash(user, userLength, name, nameLength);
+  const size_t mask = slots.size() - 1;
+
+  for (size_t slot = _hash & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+    const Entry& entry = entries[slots[slot] - 1];
+    if (entry.hash == _hash &&
+        entry.userLength == userLength &&
+        entry.name->size() == nameLength &&
+        memcmp(entry.user, user, userLength) == 0 &&
+        memcmp(entry.name->data(), name, nameLength) == 0) {
+      return &entry.values;
+    }
+  }
+
+  return NULL;
+}
+
+
+bool PropertyTable::contains(const char* user, size_t userLength) const
+{
+  return find(user, userLength, "", 0) != NULL;
+}
+
+
+Multimap<string, Property> PropertyTable::properties() const
+{
+  Multimap<string, Property> result;
+
+  foreach (const Entry& entry, entries) {
+    Property property;
+    property.name = *entry.name;
+    for (const PropertyValue* value = entry.values.begin;
+         value != entry.values.end;
+         ++value) {
+      property.values.push_back(
+          string(entry.values.data(*value), value->length));
+    }
+
+    result.put(string(entry.user, entry.userLength), property);
+  }
+
+  return result;
+}
+
+
+void PropertyTable::insert(const string& user, const Property& property)
+{
+  Entry entry;
+  entry.hash = hash(
+      user.data(), user.size(), property.name.data(), property.name.size());
+  entry.user = buffer.data() + buffer.size();
+  entry.userLength = user.size();
+  entry.name = &*names.insert(property.name).first;
+
+  buffer.append(user.c_str(), user.size() + 1);
+
+  entry.values.base = buffer.data();
+  entry.values.begin = values.data() + values.size();
+  foreach (const string& value, property.values) {
+    PropertyValue _value;
+    _value.offset = buffer.size();
+    _value.length = value.size();
+    values.push_back(_value);
+
+    buffer.append(value.c_str(), value.size() + 1);
+  }
+  entry.values.end = values.data() + values.size();
+
+  size_t slot = entry.hash & (slots.size() - 1);
+  while (slots[slot] != 0) {
+    slot = (slot + 1) & (slots.size() - 1);
+  }
+
+  entries.push_back(entry);
+  slots[slot] = static_cast<uint32_t>(entries.size());
+}
+
+
+uint64_t PropertyTable::hash(
+    const char* user,
+    size_t userLength,
+    const char* name,
+    size_t nameLength)
+{
+  // Hash the user, a NUL separator and the name; the separator keeps
+  // e.g. ("ab", "c") and ("a", "bc") apart.
+  return fnv1a(name, nameLength, fnv1a("", 1, fnv1a(user, userLength)));
+}
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
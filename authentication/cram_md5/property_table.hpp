@@ -0,0 +1,162 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __AUTHENTICATION_CRAM_MD5_PROPERTY_TABLE_HPP__
+#define __AUTHENTICATION_CRAM_MD5_PROPERTY_TABLE_HPP__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <stout/hashset.hpp>
+#include <stout/multimap.hpp>
+
+namespace mesos {
+namespace modules {
+namespace cram_md5 {
+
+// 64 bit FNV-1a; pass the result of a previous call as 'seed' for
+// hashing a sequence of buffers.
+inline uint64_t fnv1a(
+    const char* data,
+    size_t length,
+    uint64_t seed = 14695981039346656037ULL)
+{
+  const uint64_t prime = 1099511628211ULL;
+  for (size_t i = 0; i < length; i++) {
+    seed = (seed ^ static_cast<unsigned char>(data[i])) * prime;
+  }
+  return seed;
+}
+
+
+struct Property
+{
+  std::string name;
+  std::list<std::string> values;
+};
+
+
+// A single property value, located relative to the base of the
+// storage it lives in. The length is computed once when the storage
+// gets built so that consumers do not need to 'strlen' it. The fixed
+// width layout is shared with the on-disk CredentialDatabase.
+struct PropertyValue
+{
+  uint64_t offset;
+  uint64_t length;
+};
+
+
+// The values of a property, as a view into the table or database
+// they were looked up in. Only valid for as long as that is alive.
+struct PropertyValues
+{
+  bool empty() const { return begin == end; }
+
+  const char* data(const PropertyValue& value) const
+  {
+    return base + value.offset;
+  }
+
+  const char* base;
+  const PropertyValue* begin;
+  const PropertyValue* end;
+};
+
+
+// Immutable, flat hash index of properties keyed on (user, property
+// name). Property names are interned and all users and values live
+// in a single contiguous buffer, hence lookups do not allocate.
+//
+// Every user in a table also gets a marker, a property with an empty
+// name and no values. A user whose only property is the marker is a
+// tombstone: it has no properties but still hides the user in any
+// CredentialDatabase the table is layered on.
+class PropertyTable
+{
+public:
+  explicit PropertyTable(const Multimap<std::string, Property>& properties);
+
+  // Returns the values of property 'name' for 'user', or NULL if
+  // there is no such user or property.
+  const PropertyValues* find(
+      const char* user,
+      size_t userLength,
+      const char* name,
+      size_t nameLength) const;
+
+  // Returns whether the table has a marker for 'user', i.e., whether
+  // it holds all properties of the user.
+  bool contains(const char* user, size_t userLength) const;
+
+  // Number of entries, including markers.
+  size_t size() const { return entries.size(); }
+
+  // Returns a copy of the properties held by this table, including
+  // the markers, used when a table needs to get rebuilt with some of
+  // its users changed.
+  Multimap<std::string, Property> properties() const;
+
+  // The hash the index is keyed on; part of the CredentialDatabase
+  // format, hence it must not change.
+  static uint64_t hash(
+      const char* user,
+      size_t userLength,
+      const char* name,
+      size_t nameLength);
+
+private:
+  // Entries point into 'buffer' and 'names', copying would leave
+  // them dangling.
+  PropertyTable(const PropertyTable&);
+  PropertyTable& operator=(const PropertyTable&);
+
+  // Appends an entry; the storage must have been reserved up front.
+  void insert(const std::string& user, const Property& property);
+
+  struct Entry
+  {
+    uint64_t hash;
+    const char* user;
+    size_t userLength;
+    const std::string* name; // Interned, points into 'names'.
+    PropertyValues values;
+  };
+
+  // Backing storage for all users and values; sized up front so
+  // that the pointers handed out never get invalidated.
+  std::string buffer;
+  std::vector<PropertyValue> values;
+  hashset<std::string> names;
+
+  std::vector<Entry> entries;
+
+  // Open addressed slots holding an index into 'entries' plus one,
+  // zero marks an empty slot. The size is always a power of two.
+  std::vector<uint32_t> slots;
+};
+
+} // namespace cram_md5 {
+} // namespace modules {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_CRAM_MD5_PROPERTY_TABLE_HPP__
@@ -25,14 +25,22 @@
 #include <mesos/module/authenticatee.hpp>
 #include <mesos/module/authenticator.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
 #include "authentication/cram_md5/authenticatee.hpp"
 #include "authentication/cram_md5/authenticator.hpp"
+#include "authentication/cram_md5/metrics.hpp"
 
 using namespace mesos;
 
 using mesos::Authenticatee;
 using mesos::Authenticator;
 
+using std::string;
+
 static bool compatible()
 {
   return true;
@@ -41,7 +49,7 @@ static bool compatible()
 
 static Authenticatee* createCRAMMD5Authenticatee(const Parameters& parameters)
 {
-  return new mesos::internal::cram_md5::CRAMMD5Authenticatee();
+  return new mesos::modules::cram_md5::CRAMMD5Authenticatee();
 }
 
 
@@ -57,7 +65,46 @@ mesos::modules::Module<Authenticatee> org_apache_mesos_TestCRAMMD5Authenticatee(
 
 static Authenticator* createCRAMMD5Authenticator(const Parameters& parameters)
 {
-  return new mesos::internal::cram_md5::CRAMMD5Authenticator();
+  Option<string> database;
+  Option<string> credentials;
+  Duration reloadInterval =
+    mesos::modules::cram_md5::DEFAULT_CREDENTIALS_RELOAD_INTERVAL;
+
+  foreach (const mesos::Parameter& parameter, parameters.parameter()) {
+    if (parameter.has_key() && parameter.has_value()) {
+      if (parameter.key() == "credentials_database") {
+        database = parameter.value();
+      } else if (parameter.key() == "credentials") {
+        credentials = parameter.value();
+      } else if (parameter.key() == "credentials_reload_interval") {
+        Try<Duration> interval = Duration::parse(parameter.value());
+        if (interval.isError()) {
+          LOG(ERROR) << "Invalid 'credentials_reload_interval': "
+                     << interval.error();
+          return NULL;
+        } else if (interval.get() < Duration::zero()) {
+          LOG(ERROR) << "Invalid 'credentials_reload_interval': "
+                     << "Must not be negative";
+          return NULL;
+        }
+        reloadInterval = interval.get();
+      } else if (parameter.key() == "auxprop_metrics") {
+        if (parameter.value() == "true") {
+          mesos::modules::cram_md5::Metrics::enable();
+        }
+      } else {
+        LOG(WARNING) << "org_apache_mesos_TestCRAMMD5Authenticator does not "
+                     << "support a parameter named '" << parameter.key() << "'";
+      }
+    }
+  }
+
+  mesos::modules::cram_md5::CRAMMD5Authenticator* authenticator(
+      new mesos::modules::cram_md5::CRAMMD5Authenticator());
+
+  authenticator->prepare(database, credentials, reloadInterval);
+
+  return authenticator;
 }
 
 
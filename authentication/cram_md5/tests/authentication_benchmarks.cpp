@@ -0,0 +1,224 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End-to-end benchmark of the CRAM-MD5 authentication modules, run
+// through 'make bench'. One authenticator created through the
+// 'org_apache_mesos_TestCRAMMD5Authenticator' module serves N
+// simulated agents, each with an authenticatee created through the
+// 'org_apache_mesos_TestCRAMMD5Authenticatee' module, which all start
+// authenticating at once, like after a master failover. Prints one
+// JSON object per N with the authentications per second, the time
+// until all of them completed and latency percentiles.
+//
+// Usage: cram-md5-authentication-benchmarks [max agents]
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+#include <mesos/module.hpp>
+
+#include <mesos/authentication/authenticatee.hpp>
+#include <mesos/authentication/authenticator.hpp>
+
+#include <process/collect.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/none.hpp>
+#include <stout/nothing.hpp>
+#include <stout/numify.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+using namespace mesos;
+using namespace process;
+
+using mesos::internal::AuthenticateMessage;
+
+using std::cout;
+using std::endl;
+using std::list;
+using std::string;
+using std::vector;
+
+// Defined in 'test_authentication_modules.cpp'.
+extern mesos::modules::Module<Authenticatee>
+  org_apache_mesos_TestCRAMMD5Authenticatee;
+extern mesos::modules::Module<Authenticator>
+  org_apache_mesos_TestCRAMMD5Authenticator;
+
+
+// Stands in for the master: hands every authenticatee asking to get
+// authenticated over to the authenticator.
+class MasterProcess : public ProtobufProcess<MasterProcess>
+{
+public:
+  explicit MasterProcess(Authenticator* _authenticator)
+    : ProcessBase(ID::generate("master")),
+      authenticator(_authenticator) {}
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticateMessage>(&MasterProcess::authenticate);
+  }
+
+  void authenticate(const UPID& from, const AuthenticateMessage& message)
+  {
+    authenticator->authenticate(from);
+  }
+
+private:
+  Authenticator* authenticator;
+};
+
+
+static double percentile(const vector<double>& sorted, double percent)
+{
+  return sorted[std::min(
+      sorted.size() - 1,
+      static_cast<size_t>(sorted.size() * percent / 100))];
+}
+
+
+static void benchmark(size_t agents)
+{
+  Credentials credentials;
+  for (size_t i = 0; i < agents; i++) {
+    Credential* credential = credentials.add_credentials();
+    credential->set_principal("agent" + stringify(i));
+    credential->set_secret("secret" + stringify(i));
+  }
+
+  Owned<Authenticator> authenticator(
+      org_apache_mesos_TestCRAMMD5Authenticator.create(Parameters()));
+  CHECK(authenticator.get() != NULL);
+
+  Try<Nothing> initialize = authenticator->initialize(credentials);
+  CHECK(initialize.isSome()) << initialize.error();
+
+  MasterProcess master(authenticator.get());
+  spawn(master);
+
+  vector<Owned<Authenticatee>> authenticatees;
+  for (size_t i = 0; i < agents; i++) {
+    authenticatees.push_back(Owned<Authenticatee>(
+        org_apache_mesos_TestCRAMMD5Authenticatee.create(Parameters())));
+    CHECK(authenticatees.back().get() != NULL);
+  }
+
+  typedef std::chrono::steady_clock Clock;
+
+  // Completion time of each agent, written by the agent's own
+  // callback only.
+  vector<Clock::time_point> completed(agents);
+  list<Future<bool>> futures;
+
+  const Clock::time_point start = Clock::now();
+
+  for (size_t i = 0; i < agents; i++) {
+    Clock::time_point* done = &completed[i];
+
+    futures.push_back(
+        authenticatees[i]->authenticate(
+            master.self(), UPID(), credentials.credentials(i))
+          .onAny([done]() { *done = Clock::now(); }));
+  }
+
+  Future<list<bool>> results = collect(futures);
+  results.await();
+
+  const Clock::time_point end = Clock::now();
+
+  CHECK(results.isReady())
+    << (results.isFailed() ? results.failure() : "discarded");
+
+  foreach (bool authenticated, results.get()) {
+    CHECK(authenticated);
+  }
+
+  // The 'onAny' callbacks may still be running once 'collect' is
+  // done, wait for all of them before reading 'completed'.
+  foreach (const Future<bool>& future, futures) {
+    future.await();
+  }
+
+  vector<double> latencies;
+  foreach (const Clock::time_point& done, completed) {
+    latencies.push_back(
+        std::chrono::duration<double, std::milli>(done - start).count());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+
+  const double seconds = std::chrono::duration<double>(end - start).count();
+
+  JSON::Object result;
+  result.values["benchmark"] = "cram_md5_authentication";
+  result.values["agents"] = agents;
+  result.values["authentications_per_second"] = agents / seconds;
+  result.values["total_ms"] = seconds * 1000;
+  result.values["p50_ms"] = percentile(latencies, 50);
+  result.values["p90_ms"] = percentile(latencies, 90);
+  result.values["p99_ms"] = percentile(latencies, 99);
+  result.values["max_ms"] = latencies.back();
+
+  cout << stringify(result) << endl;
+
+  authenticatees.clear();
+
+  terminate(master);
+  wait(master);
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  size_t max = 10000;
+
+  if (argc > 1) {
+    Try<size_t> agents = numify<size_t>(argv[1]);
+    CHECK(agents.isSome()) << "Invalid max agents: " << argv[1];
+    max = agents.get();
+  }
+
+  for (size_t agents = 10; agents <= max; agents *= 10) {
+    benchmark(agents);
+  }
+
+  return EXIT_SUCCESS;
+}
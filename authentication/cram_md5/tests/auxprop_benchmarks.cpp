@@ -0,0 +1,335 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark of the auxiliary property lookup path, run through 'make
+// bench'. Lookups go either straight to the property store, as the
+// plugin does internally, or through the plugin's SASL entry point
+// with a libsasl2 property context. Each configuration of principals
+// and reader threads runs while a writer keeps reloading all
+// credentials, and prints one JSON object with the mean and 99th
+// percentile latency, the allocations per lookup and the lookups per
+// second of all readers together, which shows how lookups scale with
+// the number of readers.
+//
+// Usage: cram-md5-auxprop-benchmarks [max principals]
+
+#include <stddef.h>   // For size_t needed by sasl.h.
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sasl/sasl.h>
+#include <sasl/saslplug.h>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/multimap.hpp>
+#include <stout/numify.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/auxprop.hpp"
+#include "authentication/cram_md5/credentials.hpp"
+#include "authentication/cram_md5/property_store.hpp"
+#include "authentication/cram_md5/property_table.hpp"
+
+using namespace mesos::modules::cram_md5;
+
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+// Allocations through 'operator new' of the calling thread. Note that
+// libsasl2 allocates through 'malloc', which is not accounted.
+static thread_local uint64_t allocations = 0;
+
+
+void* operator new(size_t size)
+{
+  allocations++;
+
+  void* pointer = malloc(size);
+  if (pointer == NULL) {
+    throw std::bad_alloc();
+  }
+
+  return pointer;
+}
+
+
+void operator delete(void* pointer) noexcept
+{
+  free(pointer);
+}
+
+
+// Lookups done by each reader thread per configuration.
+static const size_t LOOKUPS = 200000;
+
+// Every this many lookups get timed individually for the percentile.
+static const size_t SAMPLING = 8;
+
+
+enum Path
+{
+  STORE,
+  SASL
+};
+
+
+// Issues lookups of random principals the way the CRAM-MD5 mechanism
+// does, through 'path'.
+class Reader
+{
+public:
+  Reader(Path _path, const vector<string>* _users, uint64_t seed)
+    : path(_path),
+      users(_users),
+      state(seed | 1),
+      plugin(NULL),
+      context(NULL)
+  {
+    if (path == SASL) {
+      int version;
+      CHECK_EQ(SASL_OK,
+               InMemoryAuxiliaryPropertyPlugin::initialize(
+                   NULL, SASL_AUXPROP_PLUG_VERSION, &version, &plugin, NULL));
+
+      context = prop_new(0);
+
+      const char* names[] = {
+        SASL_AUX_PASSWORD,
+        "*cmusaslsecretCRAM-MD5",
+        NULL
+      };
+
+      CHECK_EQ(SASL_OK, prop_request(context, names));
+
+      memset(&utils, 0, sizeof(utils));
+      utils.prop_get = &prop_get;
+      utils.prop_set = &prop_set;
+      utils.prop_erase = &prop_erase;
+
+      memset(&params, 0, sizeof(params));
+      params.utils = &utils;
+      params.propctx = context;
+      params.serverFQDN = "localhost";
+    }
+  }
+
+  ~Reader()
+  {
+    if (context != NULL) {
+      prop_dispose(&context);
+    }
+  }
+
+  // Looks up a random principal, returns whether its secret was found.
+  bool lookup()
+  {
+    // xorshift64, cheap enough to not show up in the results.
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    const string& user = (*users)[state % users->size()];
+
+    if (path == STORE) {
+      shared_ptr<const PropertyTable> table =
+        InMemoryAuxiliaryPropertyPlugin::properties()->shard(
+            user.data(), user.size());
+
+      return table->find(
+          user.data(),
+          user.size(),
+          credentials::CRAM_MD5_SECRET_PROP,
+          sizeof(credentials::CRAM_MD5_SECRET_PROP) - 1) != NULL;
+    }
+
+    prop_clear(context, 0);
+
+    plugin->auxprop_lookup(
+        plugin->glob_context, &params, 0, user.c_str(), user.size());
+
+    const propval* secret = prop_get(context) + 1;
+
+    return secret->values != NULL;
+  }
+
+private:
+  const Path path;
+  const vector<string>* users;
+  uint64_t state;
+
+  sasl_auxprop_plug_t* plugin;
+  sasl_utils_t utils;
+  sasl_server_params_t params;
+  propctx* context;
+};
+
+
+static Multimap<string, Property> generate(const vector<string>& users)
+{
+  Multimap<string, Property> properties;
+
+  foreach (const string& user, users) {
+    Property property;
+    property.name = SASL_AUX_PASSWORD_PROP;
+    property.values.push_back("secret-" + user);
+    properties.put(user, property);
+  }
+
+  return properties;
+}
+
+
+static void benchmark(Path path, size_t principals, size_t readers)
+{
+  vector<string> users;
+  users.reserve(principals);
+  for (size_t i = 0; i < principals; i++) {
+    users.push_back("principal" + stringify(i));
+  }
+
+  const Multimap<string, Property> properties = generate(users);
+
+  InMemoryAuxiliaryPropertyPlugin::load(properties);
+
+  std::atomic<bool> done(false);
+  std::atomic<size_t> loads(0);
+
+  // Keeps swapping in new snapshots of all credentials.
+  std::thread writer([&]() {
+    while (!done.load()) {
+      InMemoryAuxiliaryPropertyPlugin::load(properties);
+      loads++;
+    }
+  });
+
+  vector<vector<uint64_t>> latencies(readers);
+  vector<uint64_t> durations(readers);
+  vector<uint64_t> allocated(readers);
+
+  vector<std::thread> threads;
+  for (size_t i = 0; i < readers; i++) {
+    threads.push_back(std::thread([&, i]() {
+      Reader reader(path, &users, i + 1);
+      vector<uint64_t>& samples = latencies[i];
+      samples.reserve(LOOKUPS / SAMPLING);
+
+      const uint64_t allocationsBefore = allocations;
+
+      const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+
+      for (size_t j = 0; j < LOOKUPS; j++) {
+        if (j % SAMPLING != 0) {
+          CHECK(reader.lookup());
+          continue;
+        }
+
+        const std::chrono::steady_clock::time_point before =
+          std::chrono::steady_clock::now();
+
+        CHECK(reader.lookup());
+
+        samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - before).count());
+      }
+
+      durations[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start).count();
+
+      allocated[i] = allocations - allocationsBefore;
+    }));
+  }
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+
+  done = true;
+  writer.join();
+
+  vector<uint64_t> samples;
+  uint64_t duration = 0;
+  uint64_t slowest = 0;
+  uint64_t total = 0;
+
+  for (size_t i = 0; i < readers; i++) {
+    samples.insert(samples.end(), latencies[i].begin(), latencies[i].end());
+    duration += durations[i];
+    slowest = std::max(slowest, durations[i]);
+    total += allocated[i];
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  const double lookups = static_cast<double>(LOOKUPS * readers);
+
+  JSON::Object result;
+  result.values["benchmark"] = "cram_md5_auxprop_lookup";
+  result.values["path"] = path == STORE ? "store" : "sasl";
+  result.values["principals"] = principals;
+  result.values["readers"] = readers;
+  result.values["lookups"] = LOOKUPS * readers;
+  result.values["loads"] = loads.load();
+  result.values["ns_per_op"] = duration / lookups;
+  result.values["allocs_per_op"] = total / lookups;
+  result.values["p99_ns"] = samples[samples.size() * 99 / 100];
+  result.values["lookups_per_s"] = lookups * 1e9 / slowest;
+
+  cout << stringify(result) << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  size_t max = 1000000;
+
+  if (argc > 1) {
+    Try<size_t> principals = numify<size_t>(argv[1]);
+    CHECK(principals.isSome()) << "Invalid max principals: " << argv[1];
+    max = principals.get();
+  }
+
+  for (size_t principals = 1000; principals <= max; principals *= 10) {
+    for (size_t readers = 1; readers <= 64; readers *= 2) {
+      benchmark(STORE, principals, readers);
+      benchmark(SASL, principals, readers);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tests of the in-memory auxiliary property plugin, run through
+// 'make check'. Lookups go through the plugin's SASL entry point with
+// a property context as used by libsasl2. Exits with a failure as
+// soon as a check does not hold.
+
+#include <stddef.h>   // For size_t needed by sasl.h.
+#include <stdlib.h>
+#include <string.h>
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include <sasl/sasl.h>
+#include <sasl/saslplug.h>
+
+#include <glog/logging.h>
+
+#include <stout/multimap.hpp>
+#include <stout/none.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/auxprop.hpp"
+#include "authentication/cram_md5/credential_database.hpp"
+#include "authentication/cram_md5/property_table.hpp"
+
+using namespace mesos::modules::cram_md5;
+
+using std::list;
+using std::shared_ptr;
+using std::string;
+
+// The plugin serving the default store.
+static sasl_auxprop_plug_t* plugin = NULL;
+
+
+static Property property(const string& name, const string& value)
+{
+  Property property;
+  property.name = name;
+  property.values.push_back(value);
+  return property;
+}
+
+
+// Looks up property 'name' of 'user' the way libsasl2 does, returns
+// None if the plugin did not find it.
+static Option<list<string>> lookup(const string& user, const string& name)
+{
+  propctx* context = prop_new(0);
+
+  // Properties prefixed by '*' get looked up unless the lookup is
+  // for an authorization identity.
+  const string request = "*" + name;
+  const char* names[] = {request.c_str(), NULL};
+  CHECK_EQ(SASL_OK, prop_request(context, names));
+
+  sasl_utils_t utils;
+  memset(&utils, 0, sizeof(utils));
+  utils.prop_get = &prop_get;
+  utils.prop_set = &prop_set;
+  utils.prop_erase = &prop_erase;
+
+  sasl_server_params_t params;
+  memset(&params, 0, sizeof(params));
+  params.utils = &utils;
+  params.propctx = context;
+  params.serverFQDN = "localhost";
+
+  plugin->auxprop_lookup(
+      plugin->glob_context, &params, 0, user.c_str(), user.size());
+
+  Option<list<string>> result = None();
+
+  const propval* value = prop_get(context);
+  CHECK(value != NULL && value->name != NULL);
+
+  if (value->values != NULL) {
+    list<string> values;
+    for (unsigned i = 0; i < value->nvalues; i++) {
+      values.push_back(value->values[i]);
+    }
+    result = values;
+  }
+
+  prop_dispose(&context);
+
+  return result;
+}
+
+
+static void expect(
+    const string& user,
+    const string& name,
+    const Option<string>& expected)
+{
+  const Option<list<string>> values = lookup(user, name);
+
+  if (expected.isNone()) {
+    CHECK(values.isNone())
+      << "Unexpected '" << name << "' found for '" << user << "'";
+  } else {
+    CHECK(values.isSome())
+      << "No '" << name << "' found for '" << user << "'";
+    CHECK_EQ(1u, values.get().size());
+    CHECK_EQ(expected.get(), values.get().front());
+  }
+}
+
+
+// Compiles a database in which 'alice' and 'bob' both have a 'secret'
+// and an 'extra' property.
+static shared_ptr<const CredentialDatabase> compile(const string& directory)
+{
+  Multimap<string, Property> properties;
+  properties.put("alice", property("secret", "alice-database"));
+  properties.put("alice", property("extra", "alice-database"));
+  properties.put("bob", property("secret", "bob-database"));
+  properties.put("bob", property("extra", "bob-database"));
+
+  const string path = path::join(directory, "credentials.db");
+
+  Try<Nothing> write =
+    os::write(path, CredentialDatabase::compile(properties));
+  CHECK(write.isSome()) << write.error();
+
+  Try<CredentialDatabase*> database = CredentialDatabase::open(path);
+  CHECK(database.isSome()) << database.error();
+
+  return shared_ptr<const CredentialDatabase>(database.get());
+}
+
+
+// Mounts the database of 'compile' in the emptied default store.
+static void mount(const string& directory)
+{
+  InMemoryAuxiliaryPropertyPlugin::load(Multimap<string, Property>());
+  InMemoryAuxiliaryPropertyPlugin::mount(compile(directory));
+}
+
+
+static void testDatabase(const string& directory)
+{
+  mount(directory);
+
+  expect("alice", "secret", string("alice-database"));
+  expect("alice", "extra", string("alice-database"));
+  expect("bob", "secret", string("bob-database"));
+  expect("carol", "secret", None());
+}
+
+
+// Upserting a database user replaces all of its properties; none of
+// the properties only found in the database may leak through.
+static void testUpsertOverridesDatabase(const string& directory)
+{
+  mount(directory);
+
+  InMemoryAuxiliaryPropertyPlugin::upsert(
+      "alice", list<Property>(1, property("secret", "alice-memory")));
+
+  expect("alice", "secret", string("alice-memory"));
+  expect("alice", "extra", None());
+
+  // Other users are still served from the database.
+  expect("bob", "secret", string("bob-database"));
+  expect("bob", "extra", string("bob-database"));
+
+  // Upserting no properties at all overrides just the same.
+  InMemoryAuxiliaryPropertyPlugin::upsert("bob", list<Property>());
+
+  expect("bob", "secret", None());
+  expect("bob", "extra", None());
+}
+
+
+// Removing a database user hides it until it gets upserted again or
+// the store gets reloaded.
+static void testRemoveHidesDatabase(const string& directory)
+{
+  mount(directory);
+
+  InMemoryAuxiliaryPropertyPlugin::remove("bob");
+
+  expect("bob", "secret", None());
+  expect("bob", "extra", None());
+  expect("alice", "secret", string("alice-database"));
+
+  InMemoryAuxiliaryPropertyPlugin::upsert(
+      "bob", list<Property>(1, property("secret", "bob-memory")));
+
+  expect("bob", "secret", string("bob-memory"));
+  expect("bob", "extra", None());
+
+  InMemoryAuxiliaryPropertyPlugin::remove("bob");
+
+  expect("bob", "secret", None());
+
+  // Reloading drops the tombstone.
+  InMemoryAuxiliaryPropertyPlugin::load(Multimap<string, Property>());
+
+  expect("bob", "secret", string("bob-database"));
+}
+
+
+// In-memory users loaded in bulk override the database the same way.
+static void testLoadOverridesDatabase(const string& directory)
+{
+  mount(directory);
+
+  Multimap<string, Property> properties;
+  properties.put("alice", property("secret", "alice-memory"));
+  properties.put("carol", property("secret", "carol-memory"));
+
+  InMemoryAuxiliaryPropertyPlugin::load(properties);
+
+  expect("alice", "secret", string("alice-memory"));
+  expect("alice", "extra", None());
+  expect("bob", "extra", string("bob-database"));
+  expect("carol", "secret", string("carol-memory"));
+}
+
+
+// Users upserted or removed before a database gets mounted override
+// it all the same.
+static void testUpdateBeforeMount(const string& directory)
+{
+  InMemoryAuxiliaryPropertyPlugin::mount(
+      shared_ptr<const CredentialDatabase>());
+
+  InMemoryAuxiliaryPropertyPlugin::load(Multimap<string, Property>());
+
+  InMemoryAuxiliaryPropertyPlugin::upsert(
+      "alice", list<Property>(1, property("secret", "alice-memory")));
+  InMemoryAuxiliaryPropertyPlugin::remove("bob");
+
+  expect("alice", "secret", string("alice-memory"));
+  expect("bob", "secret", None());
+
+  InMemoryAuxiliaryPropertyPlugin::mount(compile(directory));
+
+  expect("alice", "secret", string("alice-memory"));
+  expect("alice", "extra", None());
+  expect("bob", "secret", None());
+  expect("bob", "extra", None());
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  int version;
+  CHECK_EQ(SASL_OK,
+           InMemoryAuxiliaryPropertyPlugin::initialize(
+               NULL, SASL_AUXPROP_PLUG_VERSION, &version, &plugin, NULL));
+
+  Try<string> directory = os::mkdtemp();
+  CHECK(directory.isSome()) << directory.error();
+
+  testDatabase(directory.get());
+  testUpsertOverridesDatabase(directory.get());
+  testRemoveHidesDatabase(directory.get());
+  testLoadOverridesDatabase(directory.get());
+  testUpdateBeforeMount(directory.get());
+
+  os::rmdir(directory.get());
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,334 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark of complete CRAM-MD5 handshakes run through libsasl2
+// in-process, comparing the in-memory auxiliary property plugin
+// serving precomputed secrets against a plugin serving plaintext
+// passwords, from which every handshake has to derive the HMAC-MD5
+// pad state. Run through 'make bench'; prints one JSON object per
+// configuration.
+
+#include <stddef.h>   // For size_t needed by sasl.h.
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sasl/sasl.h>
+#include <sasl/saslplug.h>
+
+#include <glog/logging.h>
+
+#include <stout/hashmap.hpp>
+#include <stout/json.hpp>
+#include <stout/multimap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/cram_md5/auxprop.hpp"
+#include "authentication/cram_md5/property_store.hpp"
+#include "authentication/cram_md5/property_table.hpp"
+
+using namespace mesos::modules::cram_md5;
+
+using std::cout;
+using std::endl;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+static const char PLAINTEXT[] = "plaintext-auxprop";
+static const char PRECOMPUTED[] = "precomputed-auxprop";
+
+
+struct Principal
+{
+  string user;
+  string password;
+  vector<char> secret; // A 'sasl_secret_t' holding the password.
+};
+
+
+// Passwords served by the plaintext plugin.
+static hashmap<string, string>* passwords = NULL;
+
+
+// Serves 'userPassword' as is, the way an auxiliary property plugin
+// without precomputed secrets does.
+#if SASL_AUXPROP_PLUG_VERSION <= 4
+static void plaintext(
+#else
+static int plaintext(
+#endif
+    void* context,
+    sasl_server_params_t* sparams,
+    unsigned flags,
+    const char* user,
+    unsigned length)
+{
+  const propval* property = sparams->utils->prop_get(sparams->propctx);
+
+  for (; property->name != NULL; property++) {
+    if (!(flags & SASL_AUXPROP_AUTHZID) &&
+        property->values == NULL &&
+        strcmp(property->name, SASL_AUX_PASSWORD) == 0) {
+      hashmap<string, string>::const_iterator password =
+        passwords->find(string(user, length));
+
+      if (password != passwords->end()) {
+        sparams->utils->prop_set(
+            sparams->propctx,
+            property->name,
+            password->second.data(),
+            static_cast<int>(password->second.size()));
+      }
+    }
+  }
+
+#if SASL_AUXPROP_PLUG_VERSION > 4
+  return SASL_OK;
+#endif
+}
+
+
+static int initialize(
+    const sasl_utils_t* utils,
+    int api,
+    int* version,
+    sasl_auxprop_plug_t** plug,
+    const char* name)
+{
+  static sasl_auxprop_plug_t plugin;
+
+  memset(&plugin, 0, sizeof(plugin));
+  plugin.auxprop_lookup = &plaintext;
+  plugin.name = const_cast<char*>(PLAINTEXT);
+
+  *version = SASL_AUXPROP_PLUG_VERSION;
+  *plug = &plugin;
+
+  return SASL_OK;
+}
+
+
+static int getoption(
+    void* context,
+    const char* plugin,
+    const char* option,
+    const char** result,
+    unsigned* length)
+{
+  if (strcmp(option, "auxprop_plugin") == 0) {
+    *result = static_cast<const char*>(context);
+  } else if (strcmp(option, "mech_list") == 0) {
+    *result = "CRAM-MD5";
+  } else if (strcmp(option, "pwcheck_method") == 0) {
+    *result = "auxprop";
+  } else {
+    return SASL_OK;
+  }
+
+  if (length != NULL) {
+    *length = strlen(*result);
+  }
+
+  return SASL_OK;
+}
+
+
+static int user(void* context, int id, const char** result, unsigned* length)
+{
+  *result = static_cast<const Principal*>(context)->user.c_str();
+  if (length != NULL) {
+    *length = strlen(*result);
+  }
+  return SASL_OK;
+}
+
+
+static int pass(
+    sasl_conn_t* connection,
+    void* context,
+    int id,
+    sasl_secret_t** secret)
+{
+  Principal* principal = static_cast<Principal*>(context);
+  *secret = reinterpret_cast<sasl_secret_t*>(principal->secret.data());
+  return SASL_OK;
+}
+
+
+// Runs a single handshake of 'principal' against the server side
+// using the auxiliary property plugin named 'auxprop'.
+static void handshake(const char* auxprop, Principal* principal)
+{
+  sasl_callback_t server[2];
+  server[0].id = SASL_CB_GETOPT;
+  server[0].proc = (int(*)()) &getoption;
+  server[0].context = const_cast<char*>(auxprop);
+  server[1].id = SASL_CB_LIST_END;
+  server[1].proc = NULL;
+  server[1].context = NULL;
+
+  sasl_callback_t client[4];
+  client[0].id = SASL_CB_USER;
+  client[0].proc = (int(*)()) &user;
+  client[0].context = principal;
+  client[1].id = SASL_CB_AUTHNAME;
+  client[1].proc = (int(*)()) &user;
+  client[1].context = principal;
+  client[2].id = SASL_CB_PASS;
+  client[2].proc = (int(*)()) &pass;
+  client[2].context = principal;
+  client[3].id = SASL_CB_LIST_END;
+  client[3].proc = NULL;
+  client[3].context = NULL;
+
+  sasl_conn_t* serverConnection = NULL;
+  CHECK_EQ(SASL_OK,
+           sasl_server_new(
+               "mesos", NULL, NULL, NULL, NULL, server, 0, &serverConnection));
+
+  sasl_conn_t* clientConnection = NULL;
+  CHECK_EQ(SASL_OK,
+           sasl_client_new(
+               "mesos", NULL, NULL, NULL, client, 0, &clientConnection));
+
+  sasl_interact_t* interact = NULL;
+  const char* output = NULL;
+  unsigned length = 0;
+  const char* mechanism = NULL;
+
+  int result = sasl_client_start(
+      clientConnection, "CRAM-MD5", &interact, &output, &length, &mechanism);
+  CHECK(result == SASL_OK || result == SASL_CONTINUE)
+    << sasl_errdetail(clientConnection);
+
+  const char* challenge = NULL;
+  unsigned challengeLength = 0;
+
+  result = sasl_server_start(
+      serverConnection,
+      mechanism,
+      length == 0 ? NULL : output,
+      length,
+      &challenge,
+      &challengeLength);
+  CHECK_EQ(SASL_CONTINUE, result) << sasl_errdetail(serverConnection);
+
+  result = sasl_client_step(
+      clientConnection,
+      challenge,
+      challengeLength,
+      &interact,
+      &output,
+      &length);
+  CHECK(result == SASL_OK || result == SASL_CONTINUE)
+    << sasl_errdetail(clientConnection);
+
+  result = sasl_server_step(
+      serverConnection, output, length, &challenge, &challengeLength);
+  CHECK_EQ(SASL_OK, result) << sasl_errdetail(serverConnection);
+
+  sasl_dispose(&clientConnection);
+  sasl_dispose(&serverConnection);
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  const size_t principals = 1000;
+  const size_t handshakes = 20000;
+
+  CHECK_EQ(SASL_OK, sasl_server_init(NULL, "mesos"));
+  CHECK_EQ(SASL_OK, sasl_client_init(NULL));
+
+  vector<Principal> _principals(principals);
+  passwords = new hashmap<string, string>();
+
+  Multimap<string, Property> properties;
+
+  for (size_t i = 0; i < principals; i++) {
+    Principal& principal = _principals[i];
+    principal.user = "principal" + stringify(i);
+    principal.password = "secret" + stringify(i);
+
+    const size_t length = principal.password.size();
+    principal.secret.resize(sizeof(sasl_secret_t) + length);
+
+    sasl_secret_t* secret =
+      reinterpret_cast<sasl_secret_t*>(principal.secret.data());
+    secret->len = length;
+    memcpy(secret->data, principal.password.data(), length);
+
+    (*passwords)[principal.user] = principal.password;
+
+    // Turned into the precomputed secret on the way in.
+    Property property;
+    property.name = SASL_AUX_PASSWORD_PROP;
+    property.values.push_back(principal.password);
+    properties.put(principal.user, property);
+  }
+
+  CHECK_EQ(SASL_OK, sasl_auxprop_add_plugin(PLAINTEXT, &initialize));
+
+  shared_ptr<PropertyStore> store(new PropertyStore());
+  store->load(properties);
+
+  Try<Nothing> attach =
+    InMemoryAuxiliaryPropertyPlugin::attach(PRECOMPUTED, store);
+  CHECK(attach.isSome()) << attach.error();
+
+  const char* plugins[] = {PLAINTEXT, PRECOMPUTED};
+
+  for (size_t i = 0; i < 2; i++) {
+    // Warm up, e.g., the plugin lookup of libsasl2.
+    for (size_t j = 0; j < 100; j++) {
+      handshake(plugins[i], &_principals[j % principals]);
+    }
+
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+    for (size_t j = 0; j < handshakes; j++) {
+      handshake(plugins[i], &_principals[j % principals]);
+    }
+
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+
+    JSON::Object result;
+    result.values["benchmark"] = "cram_md5_handshake";
+    result.values["secrets"] = i == 0 ? "plaintext" : "precomputed";
+    result.values["principals"] = principals;
+    result.values["handshakes"] = handshakes;
+    result.values["handshakes_per_second"] = handshakes / seconds;
+    result.values["ns_per_op"] = seconds * 1e9 / handshakes;
+
+    cout << stringify(result) << endl;
+  }
+
+  return EXIT_SUCCESS;
+}
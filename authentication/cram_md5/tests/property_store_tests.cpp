@@ -0,0 +1,324 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tests of the PropertyStore, run through 'make check'. Exits with a
+// failure as soon as a check does not hold.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/multimap.hpp>
+#include <stout/stringify.hpp>
+
+#include "authentication/cram_md5/property_store.hpp"
+#include "authentication/cram_md5/property_table.hpp"
+
+using namespace mesos::modules::cram_md5;
+
+using std::list;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+// Each user carries two values of this property which both hold the
+// generation of the load that put them, so that a lookup can tell
+// whether it observed a single consistent snapshot.
+static const char PROPERTY[] = "generation";
+
+
+static string user(size_t i)
+{
+  return "user" + stringify(i);
+}
+
+
+static string encode(uint64_t generation)
+{
+  return string(reinterpret_cast<const char*>(&generation), sizeof(generation));
+}
+
+
+static Multimap<string, Property> generation(size_t users, uint64_t value)
+{
+  Multimap<string, Property> properties;
+
+  for (size_t i = 0; i < users; i++) {
+    Property property;
+    property.name = PROPERTY;
+    property.values.push_back(encode(value));
+    property.values.push_back(encode(value));
+    properties.put(user(i), property);
+  }
+
+  return properties;
+}
+
+
+// Returns the generation 'user' was last loaded with, or zero if the
+// store does not know the user. Does not allocate.
+static uint64_t lookup(const PropertyStore& store, const string& user)
+{
+  shared_ptr<const PropertyTable> table =
+    store.shard(user.data(), user.size());
+
+  const PropertyValues* values =
+    table->find(user.data(), user.size(), PROPERTY, strlen(PROPERTY));
+
+  if (values == NULL) {
+    return 0;
+  }
+
+  CHECK_EQ(2, values->end - values->begin);
+
+  const PropertyValue& first = values->begin[0];
+  const PropertyValue& second = values->begin[1];
+
+  CHECK_EQ(sizeof(uint64_t), first.length);
+  CHECK_EQ(sizeof(uint64_t), second.length);
+
+  uint64_t generations[2];
+  memcpy(&generations[0], values->data(first), sizeof(uint64_t));
+  memcpy(&generations[1], values->data(second), sizeof(uint64_t));
+
+  CHECK_EQ(generations[0], generations[1])
+    << "Observed a partially updated user '" << user << "'";
+
+  return generations[0];
+}
+
+
+static void testLoad()
+{
+  PropertyStore store(16);
+
+  store.load(generation(100, 1));
+  for (size_t i = 0; i < 100; i++) {
+    CHECK_EQ(1u, lookup(store, user(i)));
+  }
+
+  // Users missing from a load are gone afterwards.
+  store.load(generation(50, 2));
+  for (size_t i = 0; i < 50; i++) {
+    CHECK_EQ(2u, lookup(store, user(i)));
+  }
+  for (size_t i = 50; i < 100; i++) {
+    CHECK_EQ(0u, lookup(store, user(i)));
+  }
+}
+
+
+static void testUpsertAndRemove()
+{
+  PropertyStore store(16);
+
+  store.load(generation(10, 1));
+
+  Property property;
+  property.name = PROPERTY;
+  property.values.push_back(encode(2));
+  property.values.push_back(encode(2));
+
+  store.upsert(user(3), list<Property>(1, property));
+  store.upsert(user(42), list<Property>(1, property));
+
+  CHECK_EQ(2u, lookup(store, user(3)));
+  CHECK_EQ(2u, lookup(store, user(42)));
+  CHECK_EQ(1u, lookup(store, user(4)));
+
+  store.remove(user(3));
+
+  CHECK_EQ(0u, lookup(store, user(3)));
+  CHECK_EQ(2u, lookup(store, user(42)));
+}
+
+
+// A snapshot handed out keeps its values alive across a concurrent
+// load, which may free the table it got replaced with meanwhile.
+static void testSnapshotOutlivesLoad()
+{
+  PropertyStore store(1);
+
+  store.load(generation(10, 1));
+
+  const string name = user(7);
+  shared_ptr<const PropertyTable> table =
+    store.shard(name.data(), name.size());
+
+  store.load(generation(10, 2));
+  store.load(generation(10, 3));
+
+  const PropertyValues* values =
+    table->find(name.data(), name.size(), PROPERTY, strlen(PROPERTY));
+
+  CHECK(values != NULL);
+
+  uint64_t value;
+  memcpy(&value, values->data(*values->begin), sizeof(value));
+
+  CHECK_EQ(1u, value);
+  CHECK_EQ(3u, lookup(store, name));
+}
+
+
+// Runs 'threads' readers against the store while a writer keeps
+// loading new generations. Every reader checks that each user is
+// always found, consistent and never goes back to an older
+// generation. How lookups scale with the number of readers gets
+// measured by the auxprop benchmarks.
+static void testConcurrentLoad(size_t threads)
+{
+  const size_t users = 4096;
+  const uint64_t generations = 16;
+
+  PropertyStore store;
+  store.load(generation(users, 1));
+
+  std::atomic<bool> done(false);
+  std::atomic<size_t> started(0);
+
+  vector<std::thread> readers;
+  for (size_t thread = 0; thread < threads; thread++) {
+    readers.push_back(std::thread([&, thread]() {
+      vector<string> names;
+      for (size_t i = 0; i < users; i++) {
+        names.push_back(user(i));
+      }
+
+      vector<uint64_t> seen(users, 1);
+
+      started++;
+
+      // Walk the users in a different order in each thread.
+      size_t i = thread % users;
+      while (!done.load(std::memory_order_relaxed)) {
+        const uint64_t value = lookup(store, names[i]);
+
+        CHECK_NE(0u, value) << "User '" << names[i] << "' disappeared";
+        CHECK_GE(value, seen[i]) << "User '" << names[i] << "' went back";
+
+        seen[i] = value;
+        i = (i + 2 * thread + 1) % users;
+      }
+    }));
+  }
+
+  std::thread writer([&]() {
+    // Only start loading once all readers are about to look up.
+    while (started.load() < threads) {
+      std::this_thread::yield();
+    }
+
+    for (uint64_t value = 2; value <= generations; value++) {
+      store.load(generation(users, value));
+    }
+    done = true;
+  });
+
+  writer.join();
+
+  foreach (std::thread& reader, readers) {
+    reader.join();
+  }
+
+  for (size_t i = 0; i < users; i++) {
+    CHECK_EQ(generations, lookup(store, user(i)));
+  }
+}
+
+
+// Like the above but with writers upserting single users, which
+// rebuilds their shard while readers keep using the previous one.
+static void testConcurrentUpsert(size_t threads)
+{
+  const size_t users = 1024;
+
+  PropertyStore store(8);
+  store.load(generation(users, 1));
+
+  std::atomic<bool> done(false);
+
+  vector<std::thread> readers;
+  for (size_t thread = 0; thread < threads; thread++) {
+    readers.push_back(std::thread([&]() {
+      while (!done.load(std::memory_order_relaxed)) {
+        for (size_t i = 0; i < users; i++) {
+          CHECK_NE(0u, lookup(store, user(i)));
+        }
+      }
+    }));
+  }
+
+  vector<std::thread> writers;
+  for (size_t thread = 0; thread < 2; thread++) {
+    writers.push_back(std::thread([&, thread]() {
+      for (uint64_t value = 2; value < 32; value++) {
+        for (size_t i = thread; i < users; i += 2) {
+          Property property;
+          property.name = PROPERTY;
+          property.values.push_back(encode(value));
+          property.values.push_back(encode(value));
+
+          store.upsert(user(i), list<Property>(1, property));
+        }
+      }
+    }));
+  }
+
+  foreach (std::thread& writer, writers) {
+    writer.join();
+  }
+
+  done = true;
+
+  foreach (std::thread& reader, readers) {
+    reader.join();
+  }
+
+  for (size_t i = 0; i < users; i++) {
+    CHECK_EQ(31u, lookup(store, user(i)));
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  testLoad();
+  testUpsertAndRemove();
+  testSnapshotOutlivesLoad();
+  testConcurrentUpsert(4);
+
+  // Also with more readers than there are cores on most machines.
+  for (size_t threads = 1; threads <= 64; threads *= 4) {
+    testConcurrentLoad(threads);
+  }
+
+  return EXIT_SUCCESS;
+}
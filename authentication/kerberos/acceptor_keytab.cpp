@@ -0,0 +1,331 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <sys/stat.h>
+
+#include <atomic>
+#include <string>
+
+#include <glog/logging.h>
+
+#include <gssapi/gssapi_krb5.h>
+
+#include <krb5/krb5.h>
+
+#include <process/delay.hpp>
+#include <process/id.hpp>
+#include <process/once.hpp>
+#include <process/process.hpp>
+
+#include <stout/error.hpp>
+#include <stout/os.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "acceptor_keytab.hpp"
+#include "gss.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using namespace process;
+
+using std::string;
+
+static std::atomic<uint64_t> swaps(0);
+
+
+class AcceptorKeytabProcess : public Process<AcceptorKeytabProcess>
+{
+public:
+  AcceptorKeytabProcess(const string& path_, const Duration& interval_)
+    : ProcessBase(ID::generate("gssapi_acceptor_keytab")),
+      path(path_),
+      interval(interval_),
+      context(NULL),
+      current(NULL),
+      previous(NULL) {}
+
+  virtual ~AcceptorKeytabProcess()
+  {
+    if (context != NULL) {
+      close(&previous);
+      close(&current);
+      krb5_free_context(context);
+    }
+  }
+
+  // Loads the keytab for the first time, ahead of getting spawned.
+  Try<Nothing> load()
+  {
+    krb5_error_code code = krb5_init_context(&context);
+    if (code != 0) {
+      context = NULL;
+      return Error("Failed to initialize Kerberos context");
+    }
+
+    if (path.empty()) {
+      char name[1024];
+      code = krb5_kt_default_name(context, name, sizeof(name));
+      if (code != 0) {
+        return error("Failed to determine default keytab", code);
+      }
+      path = name;
+    }
+
+    // Only keytab files can be watched, others get loaded once.
+    file = strings::startsWith(path, "FILE:")
+      ? path.substr(5)
+      : (strings::contains(path, ":") ? "" : path);
+
+    if (file.empty()) {
+      return swap();
+    }
+
+    // Stat ahead of reading, a change in between then shows up with
+    // the next check.
+    Try<struct stat> version = inspect();
+    if (version.isError()) {
+      return Error(version.error());
+    }
+
+    Try<string> contents = read();
+    if (contents.isError()) {
+      return Error(contents.error());
+    }
+
+    Try<Nothing> swapped = swap();
+    if (swapped.isError()) {
+      return swapped;
+    }
+
+    loaded = version.get();
+    bytes = contents.get();
+
+    return Nothing();
+  }
+
+protected:
+  virtual void initialize()
+  {
+    if (!file.empty() && interval > Duration::zero()) {
+      delay(interval, self(), &Self::check);
+    }
+  }
+
+private:
+  // Only rereads the file once its inode, size or modification time
+  // changed, and only reloads it once its contents changed.
+  void check()
+  {
+    Try<struct stat> version = inspect();
+
+    if (version.isError()) {
+      LOG(WARNING) << version.error();
+    } else if (changed(loaded, version.get())) {
+      Try<string> contents = read();
+
+      if (contents.isError()) {
+        LOG(WARNING) << contents.error();
+      } else if (contents.get() == bytes) {
+        loaded = version.get();
+      } else {
+        LOG(INFO) << "Keytab '" << path << "' changed, reloading";
+
+        Try<Nothing> swapped = swap();
+        if (swapped.isError()) {
+          LOG(WARNING) << "Keeping the previous keytab: " << swapped.error();
+        } else {
+          loaded = version.get();
+          bytes = contents.get();
+        }
+      }
+    }
+
+    delay(interval, self(), &Self::check);
+  }
+
+  static bool changed(const struct stat& before, const struct stat& after)
+  {
+    return before.st_dev != after.st_dev ||
+           before.st_ino != after.st_ino ||
+           before.st_size != after.st_size ||
+           before.st_mtime != after.st_mtime;
+  }
+
+  Try<struct stat> inspect()
+  {
+    struct stat s;
+    if (::stat(file.c_str(), &s) < 0) {
+      return ErrnoError("Failed to stat keytab '" + file + "'");
+    }
+
+    return s;
+  }
+
+  Try<string> read()
+  {
+    Try<string> contents = os::read(file);
+    if (contents.isError()) {
+      return Error(
+          "Failed to read keytab '" + file + "': " + contents.error());
+    }
+
+    return contents;
+  }
+
+  // Copies the keytab into a new in-memory keytab and registers it.
+  Try<Nothing> swap()
+  {
+    krb5_keytab source;
+    krb5_error_code code = krb5_kt_resolve(context, path.c_str(), &source);
+    if (code != 0) {
+      return error("Failed to resolve keytab '" + path + "'", code);
+    }
+
+    const string name =
+      "MEMORY:mesos_gssapi_acceptor_" + stringify(swaps.load() + 1);
+
+    krb5_keytab copy;
+    code = krb5_kt_resolve(context, name.c_str(), &copy);
+    if (code != 0) {
+      krb5_kt_close(context, source);
+      return error("Failed to create in-memory keytab", code);
+    }
+
+    size_t entries = 0;
+
+    krb5_kt_cursor cursor;
+    code = krb5_kt_start_seq_get(context, source, &cursor);
+    if (code == 0) {
+      krb5_keytab_entry entry;
+      while ((code = krb5_kt_next_entry(
+                  context, source, &entry, &cursor)) == 0) {
+        code = krb5_kt_add_entry(context, copy, &entry);
+        krb5_free_keytab_entry_contents(context, &entry);
+        if (code != 0) {
+          break;
+        }
+        entries++;
+      }
+      krb5_kt_end_seq_get(context, source, &cursor);
+
+      if (code == KRB5_KT_END) {
+        code = 0;
+      }
+    }
+
+    krb5_kt_close(context, source);
+
+    if (code != 0 || entries == 0) {
+      krb5_kt_close(context, copy);
+      return code != 0
+        ? error("Failed to copy keytab '" + path + "'", code)
+        : Error("Keytab '" + path + "' is empty");
+    }
+
+    OM_uint32 major = krb5_gss_register_acceptor_identity(name.c_str());
+    if (GSS_ERROR(major)) {
+      krb5_kt_close(context, copy);
+      return Error("Failed to register in-memory keytab: " +
+                   status(major, 0));
+    }
+
+    // In-memory keytabs vanish with their last handle.
+    close(&previous);
+    previous = current;
+    current = copy;
+
+    swaps++;
+
+    LOG(INFO) << "Loaded " << entries << " keytab entries from '" << path
+              << "' into " << name;
+
+    return Nothing();
+  }
+
+  void close(krb5_keytab* keytab)
+  {
+    if (*keytab != NULL) {
+      krb5_kt_close(context, *keytab);
+      *keytab = NULL;
+    }
+  }
+
+  Error error(const string& message, krb5_error_code code)
+  {
+    const char* details = krb5_get_error_message(context, code);
+    Error error(message + ": " + details);
+    krb5_free_error_message(context, details);
+    return error;
+  }
+
+  string path;
+
+  // The file behind 'path', empty if it cannot be watched.
+  string file;
+
+  const Duration interval;
+
+  krb5_context context;
+  krb5_keytab current;
+  krb5_keytab previous;
+
+  // Status and contents of the file as last loaded.
+  struct stat loaded;
+  string bytes;
+};
+
+
+Try<Nothing> AcceptorKeytab::preload(
+    const string& path,
+    const Duration& interval)
+{
+  static Once* initialize = new Once();
+  static Option<Error>* error = new Option<Error>();
+
+  if (!initialize->once()) {
+    AcceptorKeytabProcess* process = new AcceptorKeytabProcess(path, interval);
+
+    Try<Nothing> loaded = process->load();
+    if (loaded.isError()) {
+      *error = Error("Failed to preload keytab: " + loaded.error());
+      delete process;
+    } else {
+      spawn(process, true); // Lives as long as the process.
+    }
+
+    initialize->done();
+  }
+
+  if (error->isSome()) {
+    return error->get();
+  }
+
+  return Nothing();
+}
+
+
+uint64_t AcceptorKeytab::generation()
+{
+  return swaps.load();
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
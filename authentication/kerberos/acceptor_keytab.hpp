@@ -0,0 +1,65 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_ACCEPTOR_KEYTAB_HPP__
+#define __AUTHENTICATION_GSSAPI_ACCEPTOR_KEYTAB_HPP__
+
+#include <stdint.h>
+
+#include <string>
+
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// How often a preloaded keytab gets checked for a rotated key.
+const Duration DEFAULT_KEYTAB_RELOAD_INTERVAL = Seconds(10);
+
+
+// Copies the acceptor keytab into an in-memory (MEMORY:) keytab and
+// registers that as the acceptor identity of the process, so that
+// accepting a security context does not read the keytab file. The
+// file gets stat'ed every 'interval', reread only once its inode,
+// size or modification time changed, and once its contents changed,
+// e.g., after a key rotation, it gets copied into a new in-memory
+// keytab which then replaces the registered one in a single step. Handshakes in
+// flight got their service key at the start already, the previous
+// keytab is kept around until the next swap nevertheless.
+//
+// Process wide, as is the acceptor identity of Kerberos.
+class AcceptorKeytab
+{
+public:
+  // Preloads the keytab at 'path', the default one if empty. Only the
+  // first call has an effect, later ones return its result.
+  static Try<Nothing> preload(const std::string& path,
+                              const Duration& interval);
+
+  // Increases with every swap, for holders of acceptor credentials to
+  // notice they should acquire them again.
+  static uint64_t generation();
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_ACCEPTOR_KEYTAB_HPP__
@@ -17,19 +17,44 @@
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gssapi/gssapi.h>
+
 #include <sasl/sasl.h>
 
 #include <mesos/mesos.hpp>
 
 #include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/once.hpp>
 #include <process/protobuf.hpp>
 
-#include <stout/net.hpp>
+#include <process/metrics/counter.hpp>
+#include <process/metrics/gauge.hpp>
+#include <process/metrics/metrics.hpp>
+#include <process/metrics/timer.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
 #include "authenticatee.hpp"
+#include "authenticator.hpp"
+#include "backoff.hpp"
+#include "credential_cache.hpp"
+#include "gss.hpp"
+#include "metrics.hpp"
+#include "resolver.hpp"
 
 // We need to disable the deprecation warnings as Apple has decided
 // to deprecate all of CyrusSASL's functions with OS 10.11
@@ -45,37 +70,142 @@ namespace gssapi {
 
 using namespace process;
 
+using std::shared_ptr;
 using std::string;
 
+// Metrics of all authenticatees of the process, as agents and
+// schedulers create a new authenticatee for every authentication.
+struct AuthenticateeMetrics
+{
+  AuthenticateeMetrics()
+    : authentications_started("gssapi_authenticatee/authentications_started"),
+      authentications_completed(
+          "gssapi_authenticatee/authentications_completed"),
+      authentications_failed("gssapi_authenticatee/authentications_failed"),
+      authentications_errored("gssapi_authenticatee/authentications_errored"),
+      authentications_discarded(
+          "gssapi_authenticatee/authentications_discarded"),
+      handshakes_retried("gssapi_authenticatee/handshakes_retried"),
+      authentications_active(
+          "gssapi_authenticatee/authentications_active",
+          defer([this]() {
+            return static_cast<double>(active.load());
+          })),
+      resolve_ms("gssapi_authenticatee/resolve_ms"),
+      phase_mechanisms_ms("gssapi_authenticatee/phase_mechanisms_ms"),
+      sasl_start_ms("gssapi_authenticatee/sasl_start_ms"),
+      phase_steps_ms("gssapi_authenticatee/phase_steps_ms"),
+      handshake_ms("gssapi_authenticatee/handshake_ms"),
+      active(0)
+  {
+    process::metrics::add(authentications_started);
+    process::metrics::add(authentications_completed);
+    process::metrics::add(authentications_failed);
+    process::metrics::add(authentications_errored);
+    process::metrics::add(authentications_discarded);
+    process::metrics::add(handshakes_retried);
+    process::metrics::add(authentications_active);
+    process::metrics::add(resolve_ms);
+    process::metrics::add(phase_mechanisms_ms);
+    process::metrics::add(sasl_start_ms);
+    process::metrics::add(phase_steps_ms);
+    process::metrics::add(handshake_ms);
+  }
+
+  // Counts a SASL result other than SASL_OK and SASL_CONTINUE, the
+  // counter of a result gets added once it first occurred.
+  void failure(int result)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!sasl_failures.contains(result)) {
+      process::metrics::Counter counter(
+          "gssapi_authenticatee/sasl_failures/" + saslResultName(result));
+      process::metrics::add(counter);
+      sasl_failures.put(result, counter);
+    }
+
+    ++sasl_failures.at(result);
+  }
+
+  // Outcomes of the authentications, an authentication ends either
+  // completed, failed, errored (once out of handshakes) or discarded,
+  // which includes superseded ones.
+  process::metrics::Counter authentications_started;
+  process::metrics::Counter authentications_completed;
+  process::metrics::Counter authentications_failed;
+  process::metrics::Counter authentications_errored;
+  process::metrics::Counter authentications_discarded;
+  process::metrics::Counter handshakes_retried;
+
+  process::metrics::Gauge authentications_active;
+
+  // Time to resolve the hostname of the master, from sending the
+  // request until the mechanisms arrived, of sasl_client_start, which
+  // is where tickets get acquired, from sending the start until
+  // completion, and of completed handshakes.
+  process::metrics::Timer<Milliseconds> resolve_ms;
+  process::metrics::Timer<Milliseconds> phase_mechanisms_ms;
+  process::metrics::Timer<Milliseconds> sasl_start_ms;
+  process::metrics::Timer<Milliseconds> phase_steps_ms;
+  process::metrics::Timer<Milliseconds> handshake_ms;
+
+  // Authentications in flight, maintained by the attempts.
+  std::atomic<int64_t> active;
+
+  std::mutex mutex;
+  hashmap<int, process::metrics::Counter> sasl_failures;
+};
+
+
+// Never deleted, the metrics stay around for later authenticatees.
+static AuthenticateeMetrics* metrics()
+{
+  static AuthenticateeMetrics* metrics = new AuthenticateeMetrics();
+  return metrics;
+}
+
+
+// A single process serves all authentications of an authenticatee,
+// one attempt per master at a time. Messages of the authenticator get
+// routed to the attempt by the address they come from; a new attempt
+// against the same master supersedes the one in flight.
 class GSSAPIAuthenticateeProcess
   : public ProtobufProcess<GSSAPIAuthenticateeProcess>
 {
 public:
-  GSSAPIAuthenticateeProcess(const UPID& client_,
-                             const string& principal_,
-                             const string& service_,
-                             const string& serverPrefix_)
+  GSSAPIAuthenticateeProcess(const string& service_,
+                             const string& serverPrefix_,
+                             const GSSAPIAuthenticatee::Options& options_)
     : ProcessBase(ID::generate("authenticatee")),
-      principal(principal_),
       service(service_),
       serverPrefix(serverPrefix_),
-      client(client_),
-      status(READY),
-      connection(NULL) {}
+      options(options_),
+      attemptId(0) {}
 
   virtual ~GSSAPIAuthenticateeProcess()
   {
-    if (connection != NULL) {
-      sasl_dispose(&connection);
+    foreachvalue (gss_cred_id_t credential, credentials) {
+      OM_uint32 minor;
+      gss_release_cred(&minor, &credential);
     }
   }
 
   virtual void finalize()
   {
-    discarded(); // Fail the promise.
+    foreachvalue (const shared_ptr<Attempt>& attempt, attempts) {
+      ++metrics()->authentications_discarded;
+      attempt->status = Attempt::DISCARDED;
+      attempt->promise.fail("Authentication discarded");
+    }
+
+    attempts.clear();
   }
 
-  Future<bool> authenticate(const UPID& pid)
+  Future<bool> authenticate(
+      const UPID& pid,
+      const UPID& client,
+      const string& principal)
   {
     static Once* initialize = new Once();
     static bool initialized = false;
@@ -84,11 +214,9 @@ public:
       LOG(INFO) << "Initializing client SASL";
       int result = sasl_client_init(NULL);
       if (result != SASL_OK) {
-        status = ERROR;
         string error(sasl_errstring(result, NULL, NULL));
-        promise.fail("Failed to initialize SASL: " + error);
         initialize->done();
-        return promise.future();
+        return Failure("Failed to initialize SASL: " + error);
       }
 
       initialized = true;
@@ -97,89 +225,131 @@ public:
     }
 
     if (!initialized) {
-      promise.fail("Failed to initialize SASL");
-      return promise.future();
+      return Failure("Failed to initialize SASL");
     }
 
-    if (status != READY) {
-      return promise.future();
+    const string key = stringify(pid.address);
+
+    Option<shared_ptr<Attempt>> previous = attempts.get(key);
+    if (previous.isSome()) {
+      LOG(INFO) << "Superseding authentication in flight against " << pid;
+      ++metrics()->authentications_discarded;
+      previous.get()->status = Attempt::DISCARDED;
+      previous.get()->promise.fail(
+          "Authentication superseded by a new attempt");
+      attempts.erase(key);
     }
 
-    LOG(INFO) << "Creating new client SASL connection";
+    shared_ptr<Attempt> attempt(new Attempt(
+        attemptId++,
+        pid,
+        client,
+        principal,
+        Backoff(options.retryBackoffMin, options.retryBackoffMax)));
 
-    callbacks[0].id = SASL_CB_GETREALM;
-    callbacks[0].proc = NULL;
-    callbacks[0].context = NULL;
+    attempts.put(key, attempt);
 
-    callbacks[1].id = SASL_CB_USER;
-    callbacks[1].proc = (int(*)()) &user;
-    callbacks[1].context = (void*) principal.c_str();
+    ++metrics()->authentications_started;
 
-    // NOTE: Some SASL mechanisms do not allow/enable "proxying",
-    // i.e., authorization. Therefore, some mechanisms send _only_ the
-    // authorization name rather than both the user (authentication
-    // name) and authorization name. Thus, for now, we assume
-    // authorization is handled out-of-band. Consider the
-    // SASL_NEED_PROXY flag if we want to reconsider this in the
-    // future.
-    callbacks[2].id = SASL_CB_AUTHNAME;
-    callbacks[2].proc = (int(*)()) &user;
-    callbacks[2].context = (void*) principal.c_str();
+    // Stop authenticating if nobody cares.
+    Future<bool> future = attempt->promise.future();
+    future.onDiscard(defer(self(), &Self::discarded, key, attempt->id));
 
-    callbacks[3].id = SASL_CB_PASS;
-    callbacks[3].proc = (int(*)()) &pass;
-    callbacks[3].context = (void*) NULL;
+    // Tickets right after startup come from the credential cache, if
+    // any, once it got filled.
+    CredentialCache::ready(principal)
+      .onAny(defer(self(), &Self::resolve, key, attempt->id));
 
-    callbacks[4].id = SASL_CB_LIST_END;
-    callbacks[4].proc = NULL;
-    callbacks[4].context = NULL;
+    return future;
+  }
 
-    if (!service.empty()) {
-      LOG(INFO) << "SASL service name: " << service;
+  // Starts a handshake of the attempt.
+  void resolve(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(key, id);
+    if (attempt_.isNone() || attempt_.get()->status != Attempt::READY) {
+      return; // Superseded or discarded meanwhile.
     }
-    const char* service_ = service.empty() ? "mesos" : service.c_str();
 
-    // Resolve server's hostname from pid ip.
-    Try<string> hostname = net::getHostname(pid.address.ip);
-    if (hostname.isError()) {
-      status = ERROR;
-      promise.fail("Failed to resolve hostname: " + hostname.error());
-      return promise.future();
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    const size_t handshake = ++attempt->handshakes;
+
+    attempt->handshake.start(metrics()->handshake_ms);
+
+    if (options.handshakeTimeout > Seconds(0)) {
+      delay(options.handshakeTimeout,
+            self(),
+            &Self::timeout,
+            key,
+            id,
+            handshake);
     }
-    string server = hostname.get();
 
-    if (!serverPrefix.empty()) {
-      server = serverPrefix + server;
+    // Resolve server's hostname from pid ip, without blocking this
+    // process on the resolver.
+    metrics()->resolve_ms.time(Resolver::hostname(
+        attempt->pid.address.ip,
+        options.dnsTtl,
+        options.dnsNegativeTtl))
+      .onAny(defer(self(),
+                   &Self::_authenticate,
+                   key,
+                   id,
+                   handshake,
+                   lambda::_1));
+  }
+
+  void _authenticate(
+      const string& key,
+      uint64_t id,
+      size_t handshake,
+      const Future<string>& hostname)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(key, id);
+    if (attempt_.isNone() ||
+        attempt_.get()->handshakes != handshake ||
+        attempt_.get()->status != Attempt::READY) {
+      return; // Superseded, discarded or timed out meanwhile.
     }
-    LOG(INFO) << "SASL connecting to server: " << server;
-    const char* server_ = server.c_str();
 
-    int result = sasl_client_new(
-        service_,   // Registered name of service.
-        server_,    // Server's FQDN.
-        NULL, NULL, // IP Address information strings.
-        callbacks,  // Callbacks supported only for this connection.
-        0,          // Security flags (security layers are enabled
-                    // using security properties, separately).
-        &connection);
+    shared_ptr<Attempt> attempt = attempt_.get();
 
-    if (result != SASL_OK) {
-      status = ERROR;
-      string error(sasl_errstring(result, NULL, NULL));
-      promise.fail("Failed to create client SASL connection: " + error);
-      return promise.future();
+    if (!hostname.isReady()) {
+      retry(attempt,
+           "Failed to resolve hostname: " +
+           (hostname.isFailed() ? hostname.failure() : "discarded"));
+      return;
     }
 
-    AuthenticateMessage message;
-    message.set_pid(client);
-    send(pid, message);
+    attempt->server = serverPrefix + hostname.get();
 
-    status = STARTING;
+    // Keep the service ticket of this master fresh for next time.
+    CredentialCache::prefetch(
+        service.empty() ? "mesos" : service,
+        attempt->server);
 
-    // Stop authenticating if nobody cares.
-    promise.future().onDiscard(defer(self(), &Self::discarded));
+    if (!connect(attempt)) {
+      return;
+    }
+
+    // Guess the mechanism and send the first token right away, ahead
+    // of the request, in order to save the round trip for the
+    // mechanisms. Messages to the same node get delivered in order.
+    const bool early = options.optimisticStart && start(attempt);
+    if (attempt->status != Attempt::READY) {
+      return; // Could not connect again.
+    }
 
-    return promise.future();
+    AuthenticateMessage message;
+    message.set_pid(attempt->client);
+    send(attempt->pid, message);
+
+    if (!early) {
+      attempt->phase.start(metrics()->phase_mechanisms_ms);
+    }
+
+    attempt->status = early ? Attempt::EARLY : Attempt::STARTING;
   }
 
 protected:
@@ -205,16 +375,35 @@ protected:
         &AuthenticationErrorMessage::error);
   }
 
-  void mechanisms(const std::vector<string>& mechanisms)
+  void mechanisms(const UPID& from, const std::vector<string>& mechanisms)
   {
-    if (status != STARTING) {
-      status = ERROR;
-      promise.fail("Unexpected authentication 'mechanisms' received");
+    Option<shared_ptr<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
       return;
     }
 
-    // TODO(benh): Store 'from' in order to ensure we only communicate
-    // with the same Authenticator.
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (attempt->status == Attempt::STARTING) {
+      attempt->phase.stop();
+    }
+
+    if (attempt->status == Attempt::EARLY) {
+      // The authenticator did not take our early start, negotiate on
+      // a fresh connection as the current one is past its start.
+      LOG(INFO) << "Early authentication start not accepted";
+
+      if (!connect(attempt)) {
+        return;
+      }
+
+      attempt->status = Attempt::STARTING;
+    }
+
+    if (attempt->status != Attempt::STARTING) {
+      retry(attempt, "Unexpected authentication 'mechanisms' received");
+      return;
+    }
 
     LOG(INFO) << "Received SASL authentication mechanisms: "
               << strings::join(",", mechanisms);
@@ -224,21 +413,26 @@ protected:
     unsigned length = 0;
     const char* mechanism = NULL;
 
+    Phase timing;
+    timing.start(metrics()->sasl_start_ms);
+
     int result = sasl_client_start(
-        connection,
+        attempt->connection,
         strings::join(" ", mechanisms).c_str(),
         &interact,     // Set if an interaction is needed.
         &output,       // The output string (to send to server).
         &length,       // The length of the output string.
         &mechanism);   // The chosen mechanism.
 
+    timing.stop();
+
     CHECK_NE(SASL_INTERACT, result)
       << "Not expecting an interaction (ID: " << interact->id << ")";
 
     if (result != SASL_OK && result != SASL_CONTINUE) {
-      string error(sasl_errdetail(connection));
-      status = ERROR;
-      promise.fail("Failed to start the SASL client: " + error);
+      metrics()->failure(result);
+      string error(sasl_errdetail(attempt->connection));
+      retry(attempt, "Failed to start the SASL client: " + error);
       return;
     }
 
@@ -249,16 +443,28 @@ protected:
     message.set_mechanism(mechanism);
     message.set_data(output, length);
 
-    reply(message);
+    send(from, message);
 
-    status = STEPPING;
+    attempt->phase.start(metrics()->phase_steps_ms);
+    attempt->status = Attempt::STEPPING;
   }
 
-  void step(const string& data)
+  void step(const UPID& from, const string& data)
   {
-    if (status != STEPPING) {
-      status = ERROR;
-      promise.fail("Unexpected authentication 'step' received");
+    Option<shared_ptr<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (attempt->status == Attempt::EARLY) {
+      // The authenticator took our early start.
+      attempt->status = Attempt::STEPPING;
+    }
+
+    if (attempt->status != Attempt::STEPPING) {
+      retry(attempt, "Unexpected authentication 'step' received");
       return;
     }
 
@@ -269,7 +475,7 @@ protected:
     unsigned length = 0;
 
     int result = sasl_client_step(
-        connection,
+        attempt->connection,
         data.length() == 0 ? NULL : data.data(),
         data.length(),
         &interact,
@@ -288,47 +494,390 @@ protected:
       } else {
         message.set_data(NULL, 0);
       }
-      reply(message);
+      send(from, message);
     } else {
-      status = ERROR;
-      string error(sasl_errdetail(connection));
-      promise.fail("Failed to perform authentication step: " + error);
+      metrics()->failure(result);
+      string error(sasl_errdetail(attempt->connection));
+      retry(attempt, "Failed to perform authentication step: " + error);
     }
   }
 
-  void completed()
+  void completed(const UPID& from)
   {
-    if (status != STEPPING) {
-      status = ERROR;
-      promise.fail("Unexpected authentication 'completed' received");
+    Option<shared_ptr<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (attempt->status != Attempt::STEPPING &&
+        attempt->status != Attempt::EARLY) {
+      retry(attempt, "Unexpected authentication 'completed' received");
       return;
     }
 
     LOG(INFO) << "Authentication success";
 
-    status = COMPLETED;
-    promise.set(true);
+    attempt->phase.stop();
+    attempt->handshake.stop();
+    ++metrics()->authentications_completed;
+
+    attempt->status = Attempt::COMPLETED;
+    attempt->promise.set(true);
+    attempts.erase(stringify(from.address));
   }
 
-  void failed()
+  void failed(const UPID& from)
   {
-    status = FAILED;
-    promise.set(false);
+    Option<shared_ptr<Attempt>> attempt = find(from);
+    if (attempt.isSome()) {
+      ++metrics()->authentications_failed;
+      attempt.get()->status = Attempt::FAILED;
+      attempt.get()->promise.set(false);
+      attempts.erase(stringify(from.address));
+    }
   }
 
-  void error(const string& error)
+  void error(const UPID& from, const string& error)
   {
-    status = ERROR;
-    promise.fail("Authentication error: " + error);
+    Option<shared_ptr<Attempt>> attempt = find(from);
+    if (attempt.isSome()) {
+      retry(attempt.get(), "Authentication error: " + error);
+    }
   }
 
-  void discarded()
+  void timeout(const string& key, uint64_t id, size_t handshake)
   {
-    status = DISCARDED;
-    promise.fail("Authentication discarded");
+    Option<shared_ptr<Attempt>> attempt = find(key, id);
+    if (attempt.isSome() &&
+        attempt.get()->handshakes == handshake &&
+        attempt.get()->status != Attempt::WAITING) {
+      retry(attempt.get(),
+            "Authentication timed out after " +
+            stringify(options.handshakeTimeout));
+    }
+  }
+
+  // Starts another handshake once backed off.
+  void resume(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(key, id);
+    if (attempt.isSome() && attempt.get()->status == Attempt::WAITING) {
+      attempt.get()->status = Attempt::READY;
+      resolve(key, id);
+    }
+  }
+
+  void discarded(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(key, id);
+    if (attempt.isSome()) {
+      ++metrics()->authentications_discarded;
+      attempt.get()->status = Attempt::DISCARDED;
+      attempt.get()->promise.fail("Authentication discarded");
+      attempts.erase(key);
+    }
   }
 
 private:
+  // State of a single authentication, dropped once it ended.
+  struct Attempt
+  {
+    Attempt(uint64_t _id,
+            const UPID& _pid,
+            const UPID& _client,
+            const string& _principal,
+            const Backoff& _backoff)
+      : id(_id),
+        pid(_pid),
+        client(_client),
+        principal(_principal),
+        handshakes(0),
+        backoff(_backoff),
+        status(READY),
+        connection(NULL)
+    {
+      ++metrics()->active;
+
+      callbacks[0].id = SASL_CB_GETREALM;
+      callbacks[0].proc = NULL;
+      callbacks[0].context = NULL;
+
+      callbacks[1].id = SASL_CB_USER;
+      callbacks[1].proc = (int(*)()) &user;
+      callbacks[1].context = (void*) principal.c_str();
+
+      // NOTE: Some SASL mechanisms do not allow/enable "proxying",
+      // i.e., authorization. Therefore, some mechanisms send _only_
+      // the authorization name rather than both the user
+      // (authentication name) and authorization name. Thus, for now,
+      // we assume authorization is handled out-of-band. Consider the
+      // SASL_NEED_PROXY flag if we want to reconsider this in the
+      // future.
+      callbacks[2].id = SASL_CB_AUTHNAME;
+      callbacks[2].proc = (int(*)()) &user;
+      callbacks[2].context = (void*) principal.c_str();
+
+      callbacks[3].id = SASL_CB_PASS;
+      callbacks[3].proc = (int(*)()) &pass;
+      callbacks[3].context = (void*) NULL;
+
+      callbacks[4].id = SASL_CB_LIST_END;
+      callbacks[4].proc = NULL;
+      callbacks[4].context = NULL;
+    }
+
+    ~Attempt()
+    {
+      if (connection != NULL) {
+        sasl_dispose(&connection);
+      }
+
+      --metrics()->active;
+    }
+
+    const uint64_t id;
+
+    // PID of the master.
+    const UPID pid;
+
+    // PID of the client that needs to be authenticated.
+    const UPID client;
+
+    const string principal;
+
+    // The server's FQDN, known once resolved.
+    string server;
+
+    // Handshakes started so far.
+    size_t handshakes;
+    Backoff backoff;
+
+    sasl_callback_t callbacks[5];
+
+    enum {
+      READY,
+      WAITING,    // Backing off before another handshake.
+      EARLY,      // Sent our start along with the request.
+      STARTING,
+      STEPPING,
+      COMPLETED,
+      FAILED,
+      ERROR,
+      DISCARDED
+    } status;
+
+    sasl_conn_t* connection;
+
+    // Timing of the current handshake and the phase of it.
+    Phase handshake;
+    Phase phase;
+
+    Promise<bool> promise;
+  };
+
+  // Looks up the attempt against the master at the address 'from'
+  // came from. Messages in between handshakes belong to an abandoned
+  // one and get ignored.
+  Option<shared_ptr<Attempt>> find(const UPID& from)
+  {
+    Option<shared_ptr<Attempt>> attempt =
+      attempts.get(stringify(from.address));
+
+    if (attempt.isNone()) {
+      LOG(WARNING) << "Ignoring authentication message from " << from
+                   << " without an attempt in flight";
+      return None();
+    }
+
+    if (attempt.get()->status == Attempt::READY ||
+        attempt.get()->status == Attempt::WAITING) {
+      LOG(WARNING) << "Ignoring authentication message from " << from
+                   << " in between handshakes";
+      return None();
+    }
+
+    return attempt;
+  }
+
+  Option<shared_ptr<Attempt>> find(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt = attempts.get(key);
+    if (attempt.isSome() && attempt.get()->id == id) {
+      return attempt;
+    }
+    return None();
+  }
+
+  // Fails 'attempt' and drops it.
+  void fail(const shared_ptr<Attempt>& attempt, const string& message)
+  {
+    ++metrics()->authentications_errored;
+    attempt->status = Attempt::ERROR;
+    attempt->promise.fail(message);
+
+    const string key = stringify(attempt->pid.address);
+    if (find(key, attempt->id).isSome()) {
+      attempts.erase(key);
+    }
+  }
+
+  // Fails 'attempt' unless it has handshakes left, in which case
+  // another one starts after backing off.
+  void retry(const shared_ptr<Attempt>& attempt, const string& message)
+  {
+    if (attempt->handshakes >= options.maxAttempts) {
+      fail(attempt, message);
+      return;
+    }
+
+    ++metrics()->handshakes_retried;
+
+    const Duration backoff = attempt->backoff.next();
+
+    LOG(WARNING) << message << "; trying again in " << backoff
+                 << " (handshake " << attempt->handshakes << " of "
+                 << options.maxAttempts << ")";
+
+    if (attempt->connection != NULL) {
+      sasl_dispose(&attempt->connection);
+    }
+
+    attempt->status = Attempt::WAITING;
+
+    delay(backoff,
+          self(),
+          &Self::resume,
+          stringify(attempt->pid.address),
+          attempt->id);
+  }
+
+  // Creates the client SASL connection to the server of 'attempt',
+  // replacing the previous one, if any. Fails the attempt on error.
+  bool connect(const shared_ptr<Attempt>& attempt)
+  {
+    if (attempt->connection != NULL) {
+      sasl_dispose(&attempt->connection);
+    }
+
+    if (!service.empty()) {
+      LOG(INFO) << "SASL service name: " << service;
+    }
+    const char* service_ = service.empty() ? "mesos" : service.c_str();
+
+    LOG(INFO) << "SASL connecting to server: " << attempt->server;
+
+    int result = sasl_client_new(
+        service_,                 // Registered name of service.
+        attempt->server.c_str(),  // Server's FQDN.
+        NULL, NULL,               // IP Address information strings.
+        attempt->callbacks,       // Callbacks supported only for this
+                                  // connection.
+        0,                        // Security flags (security layers are
+                                  // enabled using security properties,
+                                  // separately).
+        &attempt->connection);
+
+    if (result != SASL_OK) {
+      metrics()->failure(result);
+      string error(sasl_errstring(result, NULL, NULL));
+      retry(attempt, "Failed to create client SASL connection: " + error);
+      return false;
+    }
+
+    // Have the GSSAPI mechanism take the tickets from the in-memory
+    // cache of the principal rather than from the default one.
+    if (options.memoryCredentialCache) {
+      Try<gss_cred_id_t> credential = acquire(attempt->principal);
+      if (credential.isError()) {
+        retry(attempt, credential.error());
+        return false;
+      }
+
+      result = sasl_setprop(
+          attempt->connection, SASL_GSS_CREDS, credential.get());
+
+      if (result != SASL_OK) {
+        metrics()->failure(result);
+        retry(attempt,
+              "Failed to set the initiator credential: " +
+              string(sasl_errdetail(attempt->connection)));
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  // Acquires the initiator credential of 'principal' from its
+  // in-memory ticket cache, once.
+  Try<gss_cred_id_t> acquire(const string& principal)
+  {
+    Option<gss_cred_id_t> cached = credentials.get(principal);
+    if (cached.isSome()) {
+      return cached.get();
+    }
+
+    Try<gss_cred_id_t> credential =
+      initiatorCredential(principal, CredentialCache::name(principal));
+
+    if (credential.isSome()) {
+      credentials.put(principal, credential.get());
+    }
+
+    return credential;
+  }
+
+  // Starts the SASL client with the GSSAPI mechanism and sends the
+  // first token to the well known authenticator process of the
+  // master. Returns false if the start had to be abandoned, in which
+  // case the mechanism gets negotiated as usual.
+  bool start(const shared_ptr<Attempt>& attempt)
+  {
+    sasl_interact_t* interact = NULL;
+    const char* output = NULL;
+    unsigned length = 0;
+    const char* mechanism = NULL;
+
+    Phase timing;
+    timing.start(metrics()->sasl_start_ms);
+
+    int result = sasl_client_start(
+        attempt->connection,
+        "GSSAPI",
+        &interact,
+        &output,
+        &length,
+        &mechanism);
+
+    timing.stop();
+
+    CHECK_NE(SASL_INTERACT, result)
+      << "Not expecting an interaction (ID: " << interact->id << ")";
+
+    if (result != SASL_OK && result != SASL_CONTINUE) {
+      metrics()->failure(result);
+      LOG(WARNING) << "Failed to start the SASL client early: "
+                   << sasl_errdetail(attempt->connection);
+      connect(attempt); // Start over for the negotiation.
+      return false;
+    }
+
+    LOG(INFO) << "Attempting to authenticate with early start of mechanism '"
+              << mechanism << "'";
+
+    AuthenticationStartMessage message;
+    message.set_mechanism(mechanism);
+    message.set_data(output, length);
+
+    send(UPID(GSSAPI_AUTHENTICATOR_ID, attempt->pid.address), message);
+
+    attempt->phase.start(metrics()->phase_steps_ms);
+
+    return true;
+  }
+
   static int user(
       void* context,
       int id,
@@ -357,49 +906,115 @@ private:
     return SASL_OK;
   }
 
-  const string principal;
   const string service;
   const string serverPrefix;
+  const GSSAPIAuthenticatee::Options options;
 
-  // PID of the client that needs to be authenticated.
-  const UPID client;
+  uint64_t attemptId;
 
-  sasl_callback_t callbacks[5];
+  // Attempts in flight, by the address of their master.
+  hashmap<string, shared_ptr<Attempt>> attempts;
 
-  enum {
-    READY,
-    STARTING,
-    STEPPING,
-    COMPLETED,
-    FAILED,
-    ERROR,
-    DISCARDED
-  } status;
+  // Initiator credentials of the in-memory ticket caches, by principal.
+  hashmap<string, gss_cred_id_t> credentials;
+};
 
-  sasl_conn_t* connection;
 
-  Promise<bool> promise;
-};
+// Returns the process shared by the authenticatees of 'key', spawning
+// it for the first one.
+static GSSAPIAuthenticateeProcess* shared(
+    const string& key,
+    const string& service,
+    const string& serverPrefix,
+    const GSSAPIAuthenticatee::Options& options)
+{
+  static std::mutex* mutex = new std::mutex();
+  static hashmap<string, GSSAPIAuthenticateeProcess*>* processes =
+    new hashmap<string, GSSAPIAuthenticateeProcess*>();
+
+  std::lock_guard<std::mutex> lock(*mutex);
+
+  Option<GSSAPIAuthenticateeProcess*> process = processes->get(key);
+  if (process.isSome()) {
+    return process.get();
+  }
+
+  GSSAPIAuthenticateeProcess* process_ =
+    new GSSAPIAuthenticateeProcess(service, serverPrefix, options);
+  spawn(process_);
+  processes->put(key, process_);
+
+  return process_;
+}
+
+
+string sharedProcessKey(
+    const UPID& client,
+    const string& service,
+    const string& serverPrefix,
+    const GSSAPIAuthenticatee::Options& options)
+{
+  std::vector<string> values;
+  values.push_back(stringify(client));
+  values.push_back(service);
+  values.push_back(serverPrefix);
+  values.push_back(stringify(options.dnsTtl));
+  values.push_back(stringify(options.dnsNegativeTtl));
+  values.push_back(stringify(options.optimisticStart));
+  values.push_back(stringify(options.memoryCredentialCache));
+  values.push_back(options.keytab);
+  values.push_back(strings::join(",", options.prefetchMasters));
+  values.push_back(stringify(options.handshakeTimeout));
+  values.push_back(stringify(options.maxAttempts));
+  values.push_back(stringify(options.retryBackoffMin));
+  values.push_back(stringify(options.retryBackoffMax));
+
+  return strings::join("\n", values);
+}
+
+
+GSSAPIAuthenticatee::Options::Options()
+  : dnsTtl(DEFAULT_DNS_TTL),
+    dnsNegativeTtl(DEFAULT_DNS_NEGATIVE_TTL),
+    optimisticStart(false),
+    memoryCredentialCache(false),
+    handshakeTimeout(Seconds(0)),
+    maxAttempts(1),
+    retryBackoffMin(DEFAULT_RETRY_BACKOFF_MIN),
+    retryBackoffMax(DEFAULT_RETRY_BACKOFF_MAX) {}
 
 
-GSSAPIAuthenticatee::GSSAPIAuthenticatee() : process(NULL) {}
+GSSAPIAuthenticatee::GSSAPIAuthenticatee()
+  : process(NULL) {}
 
 
 GSSAPIAuthenticatee::~GSSAPIAuthenticatee()
 {
-  if (process != NULL) {
-    terminate(process);
-    wait(process);
-    delete process;
+  // The process is shared with later authenticatees of the client,
+  // only the authentications of this one end along with it.
+  foreach (Future<bool> future, authentications) {
+    future.discard();
   }
 }
 
 
 void GSSAPIAuthenticatee::prepare(const string& service_,
-                                  const string& serverPrefix_)
+                                  const string& serverPrefix_,
+                                  const Options& options_)
 {
   service = service_;
   serverPrefix = serverPrefix_;
+  options = options_;
+
+  if (options.memoryCredentialCache) {
+    CredentialCache::initialize(options.keytab);
+
+    foreach (const string& master, options.prefetchMasters) {
+      CredentialCache::prefetch(
+          service.empty() ? "mesos" : service,
+          serverPrefix + master);
+    }
+  }
 }
 
 
@@ -408,16 +1023,36 @@ Future<bool> GSSAPIAuthenticatee::authenticate(
   const UPID& client,
   const mesos::Credential& credential)
 {
-  CHECK(process == NULL);
-
   CHECK(credential.has_principal());
 
-  process = new GSSAPIAuthenticateeProcess(
-      client, credential.principal(), service, serverPrefix);
-  spawn(process);
+  // The process only gets looked up once the configuration is
+  // complete.
+  if (process == NULL) {
+    process = shared(
+        sharedProcessKey(client, service, serverPrefix, options),
+        service,
+        serverPrefix,
+        options);
+  }
+
+  // Forget about the authentications which ended meanwhile.
+  authentications.erase(
+      std::remove_if(
+          authentications.begin(),
+          authentications.end(),
+          [](const Future<bool>& future) { return !future.isPending(); }),
+      authentications.end());
+
+  Future<bool> future = dispatch(
+      process,
+      &GSSAPIAuthenticateeProcess::authenticate,
+      pid,
+      client,
+      credential.principal());
+
+  authentications.push_back(future);
 
-  return dispatch(
-      process, &GSSAPIAuthenticateeProcess::authenticate, pid);
+  return future;
 }
 
 } // namespace gssapi {
@@ -18,14 +18,20 @@
 #ifndef __AUTHENTICATION_GSSAPI_AUTHENTICATEE_HPP__
 #define __AUTHENTICATION_GSSAPI_AUTHENTICATEE_HPP__
 
+#include <stddef.h>
+
 #include <string>
+#include <vector>
 
 #include <mesos/authentication/authenticatee.hpp>
 
 #include <process/future.hpp>
 #include <process/id.hpp>
+#include <process/pid.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
+
 namespace mesos {
 namespace internal {
 namespace gssapi {
@@ -33,30 +39,94 @@ namespace gssapi {
 // Forward declaration.
 class GSSAPIAuthenticateeProcess;
 
+// How long resolved and unresolvable master hostnames get cached.
+const Duration DEFAULT_DNS_TTL = Minutes(5);
+const Duration DEFAULT_DNS_NEGATIVE_TTL = Seconds(30);
+
+// Bounds of the delay before trying a handshake again.
+const Duration DEFAULT_RETRY_BACKOFF_MIN = Milliseconds(100);
+const Duration DEFAULT_RETRY_BACKOFF_MAX = Seconds(10);
+
 
 class GSSAPIAuthenticatee : public Authenticatee
 {
 public:
+  // Tuning of the authenticatee, independent of SASL.
+  struct Options
+  {
+    Options();
+
+    Duration dnsTtl;
+    Duration dnsNegativeTtl;
+
+    // Whether to send the first GSSAPI token along with the
+    // authentication request, expecting the authenticator to accept
+    // early starts. Falls back to negotiating the mechanism otherwise.
+    bool optimisticStart;
+
+    // Whether to keep tickets in process wide in-memory credential
+    // caches, one per principal, filled from 'keytab', the default
+    // keytab if empty, see CredentialCache. Service tickets of
+    // 'prefetchMasters', by hostname, get acquired up front.
+    bool memoryCredentialCache;
+    std::string keytab;
+    std::vector<std::string> prefetchMasters;
+
+    // Handshakes which end in an error, e.g., as the master failed
+    // over, or take longer than 'handshakeTimeout', unless zero, get
+    // tried again up to 'maxAttempts' handshakes in total. The delay
+    // before another handshake is drawn by Backoff from
+    // 'retryBackoffMin' and 'retryBackoffMax'. A rejection by the
+    // authenticator is final.
+    Duration handshakeTimeout;
+    size_t maxAttempts;
+    Duration retryBackoffMin;
+    Duration retryBackoffMax;
+  };
+
   GSSAPIAuthenticatee();
 
   virtual ~GSSAPIAuthenticatee();
 
   void prepare(const std::string& service,
-               const std::string& serverPrefix);
+               const std::string& serverPrefix,
+               const Options& options);
 
+  // May be called repeatedly, also concurrently against different
+  // masters. A new authentication against the same master supersedes
+  // the one in flight, also one of another authenticatee sharing the
+  // process, see 'sharedProcessKey'.
   virtual process::Future<bool> authenticate(
     const process::UPID& pid,
     const process::UPID& clientPid,
     const mesos::Credential& credential);
 
 private:
+  // Shared with the other authenticatees of the client, never deleted.
   GSSAPIAuthenticateeProcess* process;
 
+  // Authentications of this authenticatee which may still be in
+  // flight, discarded along with it.
+  std::vector<process::Future<bool>> authentications;
+
   std::string principal;
   std::string service;
   std::string serverPrefix;
+  Options options;
 };
 
+
+// Agents and schedulers create a new authenticatee for every
+// authentication. All authenticatees of a client with the same
+// configuration hence share a process, which is never terminated, so
+// that reregistering neither spawns a process nor sets up SASL again.
+// Returns the key identifying such authenticatees.
+std::string sharedProcessKey(
+    const process::UPID& client,
+    const std::string& service,
+    const std::string& serverPrefix,
+    const GSSAPIAuthenticatee::Options& options);
+
 } // namespace gssapi {
 } // namespace internal {
 } // namespace mesos {
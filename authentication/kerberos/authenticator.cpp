@@ -17,9 +17,16 @@
 
 #include <stddef.h>   // For size_t needed by sasl.h.
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#include <gssapi/gssapi.h>
+
 #include <sasl/sasl.h>
 #include <sasl/saslplug.h>
 
@@ -27,17 +34,38 @@
 
 #include <mesos/module/authenticator.hpp>
 
+#include <process/async.hpp>
 #include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/future.hpp>
 #include <process/id.hpp>
 #include <process/once.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
+#include <process/metrics/counter.hpp>
+#include <process/metrics/gauge.hpp>
+#include <process/metrics/metrics.hpp>
+#include <process/metrics/timer.hpp>
+
 #include <stout/check.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/lambda.hpp>
 #include <stout/net.hpp>
+#include <stout/none.hpp>
+#include <stout/result.hpp>
+#include <stout/strings.hpp>
 
+#include "acceptor_keytab.hpp"
 #include "authenticator.hpp"
+#include "early_starts.hpp"
+#include "gss.hpp"
+#include "metrics.hpp"
+#include "replay_cache.hpp"
+#include "worker_pool.hpp"
 
 // We need to disable the deprecation warnings as Apple has decided
 // to deprecate all of CyrusSASL's functions with OS 10.11
@@ -53,59 +81,473 @@ namespace gssapi {
 
 using namespace process;
 
+using std::shared_ptr;
 using std::string;
 
-class GSSAPIAuthenticatorSessionProcess
-  : public ProtobufProcess<GSSAPIAuthenticatorSessionProcess>
+// Lists the mechanisms offered by the SASL server. SASL only lists
+// mechanisms of a connection, hence this uses a throwaway one.
+static Try<AuthenticationMechanismsMessage> listMechanisms(
+    const char* service,
+    const char* server,
+    const char* realm)
+{
+  sasl_conn_t* connection = NULL;
+
+  int result = sasl_server_new(
+      service,    // Registered name of service.
+      server,     // Server's FQDN; NULL uses gethostname().
+      realm,      // The user realm used for password lookups;
+                  // NULL means default to FQDN.
+      NULL, NULL, // IP address information strings.
+      NULL,       // Callbacks supported only for this connection.
+      0,          // Security flags.
+      &connection);
+
+  if (result != SASL_OK) {
+    return Error(
+        string("Failed to create server SASL connection: ") +
+        sasl_errstring(result, NULL, NULL));
+  }
+
+  const char* output = NULL;
+  unsigned length = 0;
+  int count = 0;
+
+  result = sasl_listmech(
+      connection,  // The context for this connection.
+      NULL,        // Not supported.
+      "",          // What to prepend to the output string.
+      ",",         // What to separate mechanisms with.
+      "",          // What to append to the output string.
+      &output,     // The output string.
+      &length,     // The length of the output string.
+      &count);     // The count of the mechanisms in output.
+
+  if (result != SASL_OK || output == NULL) {
+    const string error =
+      string("Failed to get list of mechanisms: ") + sasl_errdetail(connection);
+    sasl_dispose(&connection);
+    return Error(error);
+  }
+
+  LOG(INFO) << "Available mechanisms: " << output;
+
+  AuthenticationMechanismsMessage message;
+
+  std::vector<string> mechanisms = strings::tokenize(output, ",");
+  foreach (const string& mechanism, mechanisms) {
+    message.add_mechanisms(mechanism);
+  }
+
+  sasl_dispose(&connection);
+
+  return message;
+}
+
+
+// Metrics of all authenticators of the process, which may run more
+// than one, e.g., in tests. The gauges add up the sessions of all of
+// them.
+struct AuthenticatorMetrics
+{
+  AuthenticatorMetrics()
+    : sessions_started("gssapi_authenticator/sessions_started"),
+      sessions_completed("gssapi_authenticator/sessions_completed"),
+      sessions_failed("gssapi_authenticator/sessions_failed"),
+      sessions_errored("gssapi_authenticator/sessions_errored"),
+      sessions_discarded("gssapi_authenticator/sessions_discarded"),
+      sessions_rejected("gssapi_authenticator/sessions_rejected"),
+      sessions_timed_out("gssapi_authenticator/sessions_timed_out"),
+      sessions_active(
+          "gssapi_authenticator/sessions_active",
+          defer([this]() {
+            return static_cast<double>(active.load());
+          })),
+      sessions_pending(
+          "gssapi_authenticator/sessions_pending",
+          defer([this]() {
+            return static_cast<double>(pending.load());
+          })),
+      phase_start_ms("gssapi_authenticator/phase_start_ms"),
+      phase_steps_ms("gssapi_authenticator/phase_steps_ms"),
+      sasl_step_ms("gssapi_authenticator/sasl_step_ms"),
+      handshake_ms("gssapi_authenticator/handshake_ms"),
+      active(0),
+      pending(0)
+  {
+    process::metrics::add(sessions_started);
+    process::metrics::add(sessions_completed);
+    process::metrics::add(sessions_failed);
+    process::metrics::add(sessions_errored);
+    process::metrics::add(sessions_discarded);
+    process::metrics::add(sessions_rejected);
+    process::metrics::add(sessions_timed_out);
+    process::metrics::add(sessions_active);
+    process::metrics::add(sessions_pending);
+    process::metrics::add(phase_start_ms);
+    process::metrics::add(phase_steps_ms);
+    process::metrics::add(sasl_step_ms);
+    process::metrics::add(handshake_ms);
+  }
+
+  // Counts a SASL result other than SASL_OK and SASL_CONTINUE, the
+  // counter of a result gets added once it first occurred.
+  void failure(int result)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!sasl_failures.contains(result)) {
+      process::metrics::Counter counter(
+          "gssapi_authenticator/sasl_failures/" + saslResultName(result));
+      process::metrics::add(counter);
+      sasl_failures.put(result, counter);
+    }
+
+    ++sasl_failures.at(result);
+  }
+
+  // Outcomes of the sessions, a session ends either completed,
+  // failed, errored (including timed out) or discarded. Rejected
+  // sessions never started.
+  process::metrics::Counter sessions_started;
+  process::metrics::Counter sessions_completed;
+  process::metrics::Counter sessions_failed;
+  process::metrics::Counter sessions_errored;
+  process::metrics::Counter sessions_discarded;
+  process::metrics::Counter sessions_rejected;
+  process::metrics::Counter sessions_timed_out;
+
+  process::metrics::Gauge sessions_active;
+  process::metrics::Gauge sessions_pending;
+
+  // Time from offering the mechanisms until the start arrived, from
+  // the start until completion, of single SASL starts and steps
+  // including waiting for a worker, and of completed handshakes.
+  process::metrics::Timer<Milliseconds> phase_start_ms;
+  process::metrics::Timer<Milliseconds> phase_steps_ms;
+  process::metrics::Timer<Milliseconds> sasl_step_ms;
+  process::metrics::Timer<Milliseconds> handshake_ms;
+
+  // Sessions past the queue and in the queue, maintained by the
+  // authenticators.
+  std::atomic<int64_t> active;
+  std::atomic<int64_t> pending;
+
+  std::mutex mutex;
+  hashmap<int, process::metrics::Counter> sasl_failures;
+};
+
+
+// Never deleted, the metrics stay around for later authenticators.
+static AuthenticatorMetrics* metrics()
+{
+  static AuthenticatorMetrics* metrics = new AuthenticatorMetrics();
+  return metrics;
+}
+
+
+// Runs all authentication sessions within a single process; messages
+// from the authenticatees get routed to their session by the sending
+// pid. Compared to a process per session this saves spawning and
+// waiting for the termination of a process for every authentication.
+//
+// The SASL server start and step calls, which is where tickets get
+// decrypted and checked against the replay cache, optionally run on a
+// pool of dedicated threads instead of this process.
+//
+// Admission is bounded by 'Options::maxSessions', sessions beyond that
+// wait in a queue of bounded depth and sessions which take longer than
+// 'Options::handshakeTimeout', queueing included, get aborted.
+//
+// With 'Options::acceptEarlyStarts' an authenticatee may send its
+// start right ahead of the authentication request, which then gets
+// used instead of offering the mechanisms, saving a round trip.
+class GSSAPIAuthenticatorProcess
+  : public ProtobufProcess<GSSAPIAuthenticatorProcess>
 {
 public:
-  explicit GSSAPIAuthenticatorSessionProcess(
-      const UPID& pid_,
+  GSSAPIAuthenticatorProcess(
       const string& service_,
       const string& serverPrefix_,
-      const string& realm_)
-      : ProcessBase(ID::generate("gssapi_authenticator_session")),
-        status(READY),
-        pid(pid_),
-        service(service_),
-        serverPrefix(serverPrefix_),
-        realm(realm_),
-        connection(NULL) {}
-
-  virtual ~GSSAPIAuthenticatorSessionProcess()
+      const string& realm_,
+      const Option<string>& hostname,
+      const string& localHostname_,
+      const AuthenticationMechanismsMessage& mechanisms,
+      const GSSAPIAuthenticator::Options& options_) :
+    ProcessBase(options_.acceptEarlyStarts
+                  ? GSSAPI_AUTHENTICATOR_ID
+                  : ID::generate("gssapi_authenticator")),
+    service(service_),
+    serverPrefix(serverPrefix_),
+    realm(realm_),
+    options(options_),
+    server(hostname.isSome() ? serverPrefix + hostname.get() : ""),
+    localHostname(localHostname_),
+    mechanismsName(mechanisms.GetTypeName()),
+    mechanismsData(mechanisms.SerializeAsString()),
+    replays(options.memoryReplayCache
+              ? new ReplayCache(options.replayCacheShards, options.clockSkew)
+              : NULL),
+    pool(options.workerThreads > 0
+           ? new WorkerPool(options.workerThreads)
+           : NULL),
+    keytabGeneration(0),
+    sessionId(0),
+    active(0)
   {
-    if (connection != NULL) {
-      sasl_dispose(&connection);
+    foreach (const string& mechanism, mechanisms.mechanisms()) {
+      offered.insert(mechanism);
     }
   }
 
+  virtual ~GSSAPIAuthenticatorProcess() {}
+
   virtual void finalize()
   {
-    discarded(); // Fail the promise.
+    foreachvalue (const shared_ptr<Session>& session, sessions) {
+      session->promise.fail("Authentication discarded");
+    }
+
+    metrics()->active -= active;
+    metrics()->pending -= queue.size();
+
+    sessions.clear();
+    queue.clear();
+    active = 0;
+    earlyStarts.clear();
   }
 
-  Future<Option<string>> authenticate()
+  Future<Option<string>> authenticate(const UPID& pid)
   {
-    if (status != READY) {
-      return promise.future();
+    VLOG(1) << "Starting authentication session for " << pid;
+
+    Option<shared_ptr<Session>> stale = sessions.get(pid);
+    if (stale.isSome()) {
+      if (!options.preemptStaleSessions) {
+        return Failure("Authentication session already active for " +
+                       string(pid));
+      }
+
+      // The authenticatee gave up on the previous attempt, e.g., after
+      // a lost message, don't make it wait for that one to drain.
+      LOG(INFO) << "Preempting stale authentication session for " << pid;
+      ++metrics()->sessions_discarded;
+      stale.get()->promise.fail("Authentication superseded by a new attempt");
+      remove(stale.get());
     }
 
-    // 'service', 'serverPrefix' as well as 'realm' may be supplied
-    // as overrides.
+    const bool full =
+      options.maxSessions > 0 && active >= options.maxSessions;
+
+    if (full && queue.size() >= options.maxPendingSessions) {
+      ++metrics()->sessions_rejected;
+
+      const string error = "Too many authentication sessions";
+      LOG(WARNING) << "Rejecting authentication of " << pid << ": " << error;
+      AuthenticationErrorMessage message;
+      message.set_error(error);
+      send(pid, message);
+      return Failure(error);
+    }
+
+    shared_ptr<Session> session(new Session(pid, sessionId++));
+
+    ++metrics()->sessions_started;
+
+    link(pid); // Don't bother waiting for a lost authenticatee.
+
+    sessions.put(pid, session);
+
+    // Stop authenticating if nobody cares. The session id guards
+    // against discarding a later session of the same authenticatee.
+    Future<Option<string>> future = session->promise.future();
+    future.onDiscard(defer(self(), &Self::discarded, pid, session->id));
+
+    // The deadline includes waiting in the queue, which otherwise
+    // would be unbounded while the active sessions keep their slots.
+    if (options.handshakeTimeout > Duration::zero()) {
+      delay(options.handshakeTimeout,
+            self(),
+            &Self::timeout,
+            pid,
+            session->id);
+    }
+
+    if (full) {
+      VLOG(1) << "Queueing authentication session for " << pid;
+      queue.push_back(session);
+      ++metrics()->pending;
+    } else {
+      begin(session);
+    }
+
+    return future;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    // Anticipate start and steps messages from the clients.
+    install<AuthenticationStartMessage>(
+        &GSSAPIAuthenticatorProcess::start,
+        &AuthenticationStartMessage::mechanism,
+        &AuthenticationStartMessage::data);
+
+    install<AuthenticationStepMessage>(
+        &GSSAPIAuthenticatorProcess::step,
+        &AuthenticationStepMessage::data);
+
+    if (!serverPrefix.empty() && options.hostnameTtl > Duration::zero()) {
+      delay(options.hostnameTtl, self(), &Self::refresh);
+    }
+  }
+
+  virtual void exited(const UPID& pid)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isSome()) {
+      ++metrics()->sessions_errored;
+      session.get()->promise.fail("Failed to communicate with authenticatee");
+      remove(session.get());
+    }
+  }
+
+  void start(const UPID& from, const string& mechanism, const string& data)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(from);
+    if (session.isNone()) {
+      if (options.acceptEarlyStarts) {
+        // The authentication request is right behind.
+        if (!earlyStarts.put(from, mechanism, data)) {
+          LOG(WARNING) << "Dropping early authentication start from "
+                       << from << ", too many pending";
+        } else {
+          VLOG(1) << "Holding on to early authentication start from " << from;
+        }
+        return;
+      }
+
+      LOG(WARNING) << "Ignoring authentication 'start' from " << from
+                   << " without an active session";
+      return;
+    }
+
+    if (session.get()->status != Session::STARTING) {
+      error(session.get(), "Unexpected authentication 'start' received");
+      return;
+    }
+
+    LOG(INFO) << "Received SASL authentication start with "
+              << mechanism << " mechanism from " << from;
+
+    session.get()->phase.stop();
+    session.get()->phase.start(metrics()->phase_steps_ms);
+
+    execute(session.get(), mechanism, data);
+  }
+
+  void step(const UPID& from, const string& data)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(from);
+    if (session.isNone()) {
+      LOG(WARNING) << "Ignoring authentication 'step' from " << from
+                   << " without an active session";
+      return;
+    }
+
+    if (session.get()->status != Session::STEPPING) {
+      error(session.get(), "Unexpected authentication 'step' received");
+      return;
+    }
+
+    LOG(INFO) << "Received SASL authentication step from " << from;
+
+    execute(session.get(), None(), data);
+  }
+
+  void discarded(const UPID& pid, uint64_t id)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isSome() && session.get()->id == id) {
+      ++metrics()->sessions_discarded;
+      session.get()->promise.fail("Authentication discarded");
+      remove(session.get());
+    }
+  }
+
+  void timeout(const UPID& pid, uint64_t id)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isSome() && session.get()->id == id) {
+      ++metrics()->sessions_timed_out;
+
+      LOG(WARNING) << "Authentication of " << pid << " timed out after "
+                   << options.handshakeTimeout;
+      error(session.get(), "Authentication timed out");
+    }
+  }
+
+private:
+  // A GSS-API credential, released along with its last reference.
+  typedef shared_ptr<gss_cred_id_struct> GSSCredential;
+
+  struct Session
+  {
+    Session(const UPID& _pid, uint64_t _id)
+      : pid(_pid), id(_id), status(QUEUED), connection(NULL) {}
+
+    ~Session()
+    {
+      if (connection != NULL) {
+        sasl_dispose(&connection);
+      }
+    }
+
+    const UPID pid;
+    const uint64_t id;
+
+    enum {
+      QUEUED,     // Waiting for a slot, see 'maxSessions'.
+      STARTING,
+      STEPPING,
+      WORKING     // A start or step is running on the worker pool.
+    } status;
+
+    sasl_conn_t* connection;
+
+    // The acceptor credential handed to 'connection', if any, kept
+    // until the connection got disposed.
+    GSSCredential credential;
+
+    // The first token, i.e., the AP-REQ, for the replay detection.
+    string token;
+
+    // Timing of the whole handshake, the current phase of it and the
+    // SASL start or step in progress, if any.
+    Phase handshake;
+    Phase phase;
+    Phase step;
+
+    Promise<Option<string>> promise;
+  };
+
+  // Starts the handshake of an admitted session.
+  void begin(const shared_ptr<Session>& session)
+  {
+    active++;
+    ++metrics()->active;
+
+    session->status = Session::STARTING;
+    session->handshake.start(metrics()->handshake_ms);
+
+    // 'service', 'server' as well as 'realm' may be supplied as
+    // overrides.
     if (!service.empty()) {
       LOG(INFO) << "SASL service name: " << service;
     }
     const char* service_ = service.empty() ? "mesos" : service.c_str();
 
-    string server = "";
-    if (!serverPrefix.empty()) {
-      Try<string> hostname = net::hostname();
-      if (hostname.isError()) {
-        status = ERROR;
-        promise.fail("Failed to resolve hostname: " + hostname.error());
-        return promise.future();
-      }
-      server = serverPrefix + hostname.get();
+    if (!server.empty()) {
       LOG(INFO) << "SASL connecting to server: " << server;
     }
     const char* server_ = server.empty() ? NULL : server.c_str();
@@ -124,308 +566,427 @@ public:
         NULL,       // Callbacks supported only for this connection.
         0,          // Security flags (security layers are enabled
                     // using security properties, separately).
-        &connection);
+        &session->connection);
 
     if (result != SASL_OK) {
+      metrics()->failure(result);
+
       string error = "Failed to create server SASL connection: ";
       error += sasl_errstring(result, NULL, NULL);
       LOG(ERROR) << error;
-      AuthenticationErrorMessage message;
-      message.set_error(error);
-      send(pid, message);
-      status = ERROR;
-      promise.fail(error);
-      return promise.future();
+      this->error(session, error);
+      return;
     }
 
-    // Get the list of mechanisms.
-    const char* output = NULL;
-    unsigned length = 0;
-    int count = 0;
-
-    result = sasl_listmech(
-        connection,  // The context for this connection.
-        NULL,        // Not supported.
-        "",          // What to prepend to the output string.
-        ",",         // What to separate mechanisms with.
-        "",          // What to append to the output string.
-        &output,     // The output string.
-        &length,     // The length of the output string.
-        &count);     // The count of the mechanisms in output.
-
-    if (result != SASL_OK || output == NULL) {
-      string error = "Failed to get list of mechanisms: ";
-      LOG(WARNING) << error << sasl_errstring(result, NULL, NULL);
-      AuthenticationErrorMessage message;
-      error += sasl_errdetail(connection);
-      message.set_error(error);
-      send(pid, message);
-      status = ERROR;
-      promise.fail(error);
-      return promise.future();
-    }
+    // Have the GSSAPI mechanism accept with a credential which skips
+    // the replay cache of Kerberos, the replays get detected here.
+    if (replays.get() != NULL) {
+      Try<GSSCredential> credential = acceptor();
+      if (credential.isError()) {
+        LOG(ERROR) << credential.error();
+        this->error(session, credential.error());
+        return;
+      }
 
-    std::vector<string> mechanisms = strings::tokenize(output, ",");
-    LOG(INFO) << "Available mechanisms: " << output;
+      session->credential = credential.get();
 
-    // Send authentication mechanisms.
-    AuthenticationMechanismsMessage message;
-    foreach (const string& mechanism, mechanisms) {
-      message.add_mechanisms(mechanism);
-    }
+      result = sasl_setprop(
+          session->connection, SASL_GSS_CREDS, credential.get().get());
 
-    send(pid, message);
+      if (result != SASL_OK) {
+        metrics()->failure(result);
 
-    status = STARTING;
+        string error = "Failed to set the acceptor credential: ";
+        error += sasl_errdetail(session->connection);
+        LOG(ERROR) << error;
+        this->error(session, error);
+        return;
+      }
+    }
 
-    // Stop authenticating if nobody cares.
-    promise.future().onDiscard(defer(self(), &Self::discarded));
+    // Skip offering the mechanisms if the authenticatee already
+    // picked one of them.
+    Option<EarlyStarts::Start> early = earlyStarts.take(session->pid);
+    if (early.isSome() && offered.contains(early.get().mechanism)) {
+      LOG(INFO) << "Received early SASL authentication start with "
+                << early.get().mechanism << " mechanism from "
+                << session->pid;
 
-    return promise.future();
-  }
+      session->phase.start(metrics()->phase_steps_ms);
 
-protected:
-  virtual void initialize()
-  {
-    link(pid); // Don't bother waiting for a lost authenticatee.
+      execute(session, early.get().mechanism, early.get().data);
+      return;
+    }
 
-    // Anticipate start and steps messages from the client.
-    install<AuthenticationStartMessage>(
-        &GSSAPIAuthenticatorSessionProcess::start,
-        &AuthenticationStartMessage::mechanism,
-        &AuthenticationStartMessage::data);
+    // The mechanisms only change with the SASL plugins, hence they
+    // got listed and serialized once up front.
+    send(session->pid,
+         mechanismsName,
+         mechanismsData.data(),
+         mechanismsData.size());
 
-    install<AuthenticationStepMessage>(
-        &GSSAPIAuthenticatorSessionProcess::step,
-        &AuthenticationStepMessage::data);
+    session->phase.start(metrics()->phase_start_ms);
   }
 
-  virtual void exited(const UPID& _pid)
+  // Outcome of a server start or step. Everything gets copied out of
+  // the connection by the thread running the step, as the buffers
+  // SASL hands out are only valid until the next call on it.
+  struct Step
+  {
+    Step() : result(SASL_FAIL), principal(None()) {}
+
+    int result;
+    Option<string> output;
+    Result<string> principal; // Only looked up on SASL_OK.
+    string error;
+  };
+
+  // Runs a server start, if 'mechanism' is given, or step on the
+  // worker pool, or right here without a pool.
+  void execute(
+      const shared_ptr<Session>& session,
+      const Option<string>& mechanism,
+      const string& data)
   {
-    if (pid == _pid) {
-      status = ERROR;
-      promise.fail("Failed to communicate with authenticatee");
+    if (mechanism.isSome()) {
+      session->token = data;
     }
-  }
 
-  void start(const string& mechanism, const string& data)
-  {
-    if (status != STARTING) {
-      AuthenticationErrorMessage message;
-      message.set_error("Unexpected authentication 'start' received");
-      send(pid, message);
-      status = ERROR;
-      promise.fail(message.error());
+    session->step.start(metrics()->sasl_step_ms);
+
+    ReplayCache* replays = this->replays.get();
+
+    if (pool.get() == NULL) {
+      handle(session, run(session, mechanism, data, replays));
       return;
     }
 
-    LOG(INFO) << "Received SASL authentication start with "
-              << mechanism.c_str() << " mechanism";
+    session->status = Session::WORKING;
 
-    // Start the server.
-    const char* output = NULL;
-    unsigned length = 0;
+    shared_ptr<Promise<Step>> promise(new Promise<Step>());
 
-    int result = sasl_server_start(
-        connection,
-        mechanism.c_str(),
-        data.length() == 0 ? NULL : data.data(),
-        data.length(),
-        &output,
-        &length);
+    promise->future()
+      .onAny(defer(
+          self(),
+          &Self::_execute,
+          session->pid,
+          session->id,
+          lambda::_1));
 
-    handle(result, output, length);
+    // The task holds on to the session, keeping its connection alive
+    // even if the session ends meanwhile.
+    pool->enqueue([=]() {
+      promise->set(run(session, mechanism, data, replays));
+    });
   }
 
-  void step(const string& data)
+  void _execute(const UPID& pid, uint64_t id, const Future<Step>& step)
   {
-    if (status != STEPPING) {
-      AuthenticationErrorMessage message;
-      message.set_error("Unexpected authentication 'step' received");
-      send(pid, message);
-      status = ERROR;
-      promise.fail(message.error());
+    // The session might have ended while the step was running.
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isNone() || session.get()->id != id) {
       return;
     }
 
-    LOG(INFO) << "Received SASL authentication step";
+    CHECK_READY(step);
+
+    handle(session.get(), step.get());
+  }
+
+  static Step run(
+      const shared_ptr<Session>& session,
+      const Option<string>& mechanism,
+      const string& data,
+      ReplayCache* replays)
+  {
+    Step step;
 
     const char* output = NULL;
     unsigned length = 0;
 
-    int result = sasl_server_step(
-        connection,
-        data.length() == 0 ? NULL : data.data(),
-        data.length(),
-        &output,
-        &length);
+    if (mechanism.isSome()) {
+      step.result = sasl_server_start(
+          session->connection,
+          mechanism.get().c_str(),
+          data.length() == 0 ? NULL : data.data(),
+          data.length(),
+          &output,
+          &length);
+    } else {
+      step.result = sasl_server_step(
+          session->connection,
+          data.length() == 0 ? NULL : data.data(),
+          data.length(),
+          &output,
+          &length);
+    }
 
-    handle(result, output, length);
-  }
+    if (output != NULL) {
+      step.output = string(output, length);
+    }
 
-  void discarded()
-  {
-    status = DISCARDED;
-    promise.fail("Authentication discarded");
+    if (step.result == SASL_OK) {
+      const char* name = NULL;
+
+      int result = sasl_getprop(
+          session->connection,
+          SASL_USERNAME,
+          (const void**) &name);
+
+      if (result != SASL_OK) {
+        step.principal = Error(sasl_errstring(result, NULL, NULL));
+        step.error = sasl_errdetail(session->connection);
+      } else {
+        step.principal = string(name);
+
+        if (replays != NULL && !replays->insert(name, session->token)) {
+          LOG(WARNING) << "Rejecting replayed authenticator of '"
+                       << name << "' from " << session->pid;
+          step.result = SASL_BADAUTH;
+        }
+      }
+    } else if (step.result != SASL_CONTINUE) {
+      step.error = sasl_errdetail(session->connection);
+    }
+
+    return step;
   }
 
-private:
-  // Helper for handling result of server start and step.
-  void handle(int result, const char* output, unsigned length)
+  // Helper for handling result of server start and step. Sessions
+  // get removed once they completed, hence 'session' is taken by
+  // value.
+  void handle(shared_ptr<Session> session, const Step& step)
   {
-    if (result == SASL_OK) {
-      char *name;
+    session->step.stop();
 
-      result = sasl_getprop(connection, SASL_USERNAME, (const void **)&name);
-
-      if (result != SASL_OK) {
+    if (step.result == SASL_OK) {
+      if (!step.principal.isSome()) {
         LOG(ERROR) << "Failed to retrieve principal after successful "
-                   << "authentication: " << sasl_errstring(result, NULL, NULL);
-        AuthenticationErrorMessage message;
-        std::string error(sasl_errdetail(connection));
-        message.set_error(error);
-        send(pid, message);
-        status = ERROR;
-        promise.fail(error);
+                   << "authentication: "
+                   << (step.principal.isError()
+                       ? step.principal.error()
+                       : "none");
+        error(session, step.error);
         return;
-      } else {
-        principal = name;
       }
 
-      LOG(INFO) << "Authentication success";
+      LOG(INFO) << "Authentication success for " << session->pid;
       // Note that we're not using SASL_SUCCESS_DATA which means that
       // we should not have any data to send when we get a SASL_OK.
-      CHECK(output == NULL);
-      send(pid, AuthenticationCompletedMessage());
-      status = COMPLETED;
-      promise.set(principal);
-    } else if (result == SASL_CONTINUE) {
+      CHECK(step.output.isNone());
+      send(session->pid, AuthenticationCompletedMessage());
+      session->phase.stop();
+      session->handshake.stop();
+      ++metrics()->sessions_completed;
+      session->promise.set(Option<string>(step.principal.get()));
+      remove(session);
+    } else if (step.result == SASL_CONTINUE) {
       LOG(INFO) << "Authentication requires more steps";
+      CHECK_SOME(step.output);
       AuthenticationStepMessage message;
-      message.set_data(CHECK_NOTNULL(output), length);
-      send(pid, message);
-      status = STEPPING;
-    } else if (result == SASL_NOUSER || result == SASL_BADAUTH) {
+      message.set_data(step.output.get());
+      send(session->pid, message);
+      session->status = Session::STEPPING;
+    } else if (step.result == SASL_NOUSER || step.result == SASL_BADAUTH) {
       LOG(WARNING) << "Authentication failure: "
-                   << sasl_errstring(result, NULL, NULL);
-      send(pid, AuthenticationFailedMessage());
-      status = FAILED;
-      promise.set(Option<string>::none());
+                   << sasl_errstring(step.result, NULL, NULL);
+      metrics()->failure(step.result);
+      ++metrics()->sessions_failed;
+      send(session->pid, AuthenticationFailedMessage());
+      session->promise.set(Option<string>::none());
+      remove(session);
     } else {
       LOG(ERROR) << "Authentication error: "
-                 << sasl_errstring(result, NULL, NULL);
-      AuthenticationErrorMessage message;
-      string error(sasl_errdetail(connection));
-      message.set_error(error);
-      send(pid, message);
-      status = ERROR;
-      promise.fail(message.error());
+                 << sasl_errstring(step.result, NULL, NULL);
+      metrics()->failure(step.result);
+      error(session, step.error);
     }
   }
 
-  enum {
-    READY,
-    STARTING,
-    STEPPING,
-    COMPLETED,
-    FAILED,
-    ERROR,
-    DISCARDED
-  } status;
-
-  const UPID pid;
+  // Fails and removes 'session' after reporting 'message' to the
+  // authenticatee.
+  void error(shared_ptr<Session> session, const string& message_)
+  {
+    AuthenticationErrorMessage message;
+    message.set_error(message_);
+    send(session->pid, message);
+    ++metrics()->sessions_errored;
+    session->promise.fail(message_);
+    remove(session);
+  }
 
-  const string service;
-  const string serverPrefix;
-  const string realm;
+  // Forgets about 'session' and hands its slot to the longest waiting
+  // session, if any.
+  void remove(const shared_ptr<Session>& session)
+  {
+    // Only erase the entry if it still belongs to this session rather
+    // than to a newer one of the same authenticatee.
+    Option<shared_ptr<Session>> current = sessions.get(session->pid);
+    if (current.isNone() || current.get()->id != session->id) {
+      return;
+    }
 
-  sasl_conn_t* connection;
+    sessions.erase(session->pid);
 
-  Promise<Option<string>> promise;
+    if (session->status == Session::QUEUED) {
+      queue.erase(
+          std::remove(queue.begin(), queue.end(), session),
+          queue.end());
+      --metrics()->pending;
+      return;
+    }
 
-  Option<string> principal;
-};
+    CHECK_GT(active, 0u);
+    active--;
+    --metrics()->active;
 
+    while (!queue.empty() &&
+           (options.maxSessions == 0 || active < options.maxSessions)) {
+      shared_ptr<Session> next = queue.front();
+      queue.pop_front();
+      --metrics()->pending;
+      begin(next);
+    }
+  }
 
-class GSSAPIAuthenticatorSession
-{
-public:
-  GSSAPIAuthenticatorSession(const UPID& pid,
-                             const string& service,
-                             const string& serverPrefix,
-                             const string& realm)
+  // Returns the acceptor credential of the server SASL names itself
+  // after, acquiring it again once the server got renamed or the
+  // keytab rotated. Sessions which got the previous one keep it.
+  Try<GSSCredential> acceptor()
   {
-    process =
-      new GSSAPIAuthenticatorSessionProcess(pid, service, serverPrefix, realm);
-    spawn(process);
+    const string host = server.empty() ? localHostname : server;
+
+    if (credential &&
+        credentialServer == host &&
+        keytabGeneration == AcceptorKeytab::generation()) {
+      return credential;
+    }
+
+    Try<gss_name_t> name =
+      serviceName(service.empty() ? "mesos" : service, host);
+
+    if (name.isError()) {
+      return Error(name.error());
+    }
+
+    Try<gss_cred_id_t> acquired = acceptorCredential(name.get(), false);
+
+    OM_uint32 minor;
+    gss_name_t name_ = name.get();
+    gss_release_name(&minor, &name_);
+
+    if (acquired.isError()) {
+      if (!credential) {
+        return Error(acquired.error());
+      }
+
+      LOG(WARNING) << "Keeping the previous acceptor credential: "
+                   << acquired.error();
+      return credential;
+    }
+
+    credential.reset(acquired.get(), [](gss_cred_id_t released) {
+      OM_uint32 ignored;
+      gss_release_cred(&ignored, &released);
+    });
+    credentialServer = host;
+    keytabGeneration = AcceptorKeytab::generation();
+
+    return credential;
   }
 
-  virtual ~GSSAPIAuthenticatorSession()
+  // Resolves our hostname again, off the process, in case it changed
+  // since we last looked. Sessions keep using the cached server name
+  // meanwhile.
+  void refresh()
   {
-    // TODO(vinod): As a short term fix for the race condition #1 in
-    // MESOS-1866, we inject the 'terminate' event at the end of the
-    // CRAMMD5AuthenticatorProcess queue instead of at the front.
-    // The long term fix for this is https://reviews.apache.org/r/25945/.
-    terminate(process, false);
-    wait(process);
-    delete process;
+    async(&net::hostname)
+      .onAny(defer(self(), &Self::_refresh, lambda::_1));
   }
 
-  virtual Future<Option<string>> authenticate()
+  void _refresh(const Future<Try<string>>& hostname)
   {
-    return dispatch(process, &GSSAPIAuthenticatorSessionProcess::authenticate);
+    if (!hostname.isReady() || hostname.get().isError()) {
+      LOG(WARNING) << "Failed to refresh hostname, keeping server '"
+                   << server << "': "
+                   << (hostname.isReady()
+                       ? hostname.get().error()
+                       : hostname.isFailed()
+                         ? hostname.failure()
+                         : "discarded");
+    } else if (serverPrefix + hostname.get().get() != server) {
+      server = serverPrefix + hostname.get().get();
+      LOG(INFO) << "Hostname changed, SASL server now: " << server;
+    }
+
+    delay(options.hostnameTtl, self(), &Self::refresh);
   }
 
-private:
-  GSSAPIAuthenticatorSessionProcess* process;
-};
+  const string service;
+  const string serverPrefix;
+  const string realm;
 
+  const GSSAPIAuthenticator::Options options;
 
-class GSSAPIAuthenticatorProcess :
-  public Process<GSSAPIAuthenticatorProcess>
-{
-public:
-  GSSAPIAuthenticatorProcess() :
-    ProcessBase(ID::generate("gssapi_authenticator")) {}
+  // The server's FQDN handed to new sessions, empty if it should be
+  // determined by SASL.
+  string server;
 
-  virtual ~GSSAPIAuthenticatorProcess() {}
+  // What SASL determines the server's FQDN to be, i.e., our hostname.
+  const string localHostname;
 
-  Future<Option<string>> authenticate(const UPID& pid,
-                                      const string& service,
-                                      const string& serverPrefix,
-                                      const string& realm)
-  {
-    VLOG(1) << "Starting authentication session for " << pid;
+  // The serialized AuthenticationMechanismsMessage sent to every
+  // authenticatee.
+  const string mechanismsName;
+  const string mechanismsData;
+  hashset<string> offered;
 
-    if (sessions.contains(pid)) {
-      return Failure("Authentication session already active for " +
-                     string(pid));
-    }
+  // NULL if Kerberos does the replay detection. Declared ahead of the
+  // pool, which may still be using it while getting destroyed.
+  Owned<ReplayCache> replays;
 
-    Owned<GSSAPIAuthenticatorSession> session(
-        new GSSAPIAuthenticatorSession(pid, service, serverPrefix, realm));
+  // NULL if SASL calls should run on this process.
+  Owned<WorkerPool> pool;
 
-    sessions.put(pid, session);
+  // Acceptor credential of 'credentialServer' from the keytab of
+  // 'keytabGeneration', only acquired along with 'replays'.
+  GSSCredential credential;
+  string credentialServer;
+  uint64_t keytabGeneration;
 
-    return session->authenticate()
-      .onAny(defer(self(), &Self::_authenticate, pid));
-  }
+  uint64_t sessionId;
 
-  virtual void _authenticate(const UPID& pid)
-  {
-    VLOG(1) << "Authentication session cleanup for " << pid;
+  // All sessions, including the queued ones.
+  hashmap<UPID, shared_ptr<Session>> sessions;
 
-    CHECK(sessions.contains(pid));
+  // Sessions waiting for a slot, oldest first.
+  std::deque<shared_ptr<Session>> queue;
 
-    sessions.erase(pid);
-  }
+  // Number of sessions past the queue.
+  size_t active;
 
-private:
-  hashmap <UPID, Owned<GSSAPIAuthenticatorSession>> sessions;
+  // Starts sent by authenticatees ahead of their request.
+  EarlyStarts earlyStarts;
 };
 
 
-GSSAPIAuthenticator::GSSAPIAuthenticator() : process(NULL) {}
+GSSAPIAuthenticator::GSSAPIAuthenticator()
+  : process(NULL) {}
+
+
+GSSAPIAuthenticator::Options::Options()
+  : hostnameTtl(DEFAULT_HOSTNAME_TTL),
+    workerThreads(0),
+    maxSessions(0),
+    maxPendingSessions(0),
+    handshakeTimeout(DEFAULT_HANDSHAKE_TIMEOUT),
+    preemptStaleSessions(false),
+    acceptEarlyStarts(false),
+    memoryReplayCache(false),
+    replayCacheShards(DEFAULT_REPLAY_CACHE_SHARDS),
+    clockSkew(DEFAULT_CLOCK_SKEW),
+    preloadKeytab(false),
+    keytabReloadInterval(DEFAULT_KEYTAB_RELOAD_INTERVAL) {}
 
 
 GSSAPIAuthenticator::~GSSAPIAuthenticator()
@@ -468,7 +1029,57 @@ Try<Nothing> GSSAPIAuthenticator::initialize(
     return error->get();
   }
 
-  process = new GSSAPIAuthenticatorProcess();
+  if (options.preloadKeytab) {
+    Try<Nothing> preloaded =
+      AcceptorKeytab::preload(options.keytab, options.keytabReloadInterval);
+    if (preloaded.isError()) {
+      return Error(preloaded.error());
+    }
+  }
+
+  // Resolve the server name once up front instead of for every
+  // session; it gets refreshed in the background from here on.
+  Option<string> hostname;
+  if (!serverPrefix.empty()) {
+    Try<string> resolved = net::hostname();
+    if (resolved.isError()) {
+      return Error("Failed to resolve hostname: " + resolved.error());
+    }
+    hostname = resolved.get();
+  }
+
+  const string server =
+    hostname.isSome() ? serverPrefix + hostname.get() : "";
+
+  // Names the acceptor credential handed to SASL when it determines
+  // the server itself.
+  string localHostname;
+  if (options.memoryReplayCache && serverPrefix.empty()) {
+    Try<string> resolved = net::hostname();
+    if (resolved.isError()) {
+      return Error("Failed to resolve hostname: " + resolved.error());
+    }
+    localHostname = resolved.get();
+  }
+
+  Try<AuthenticationMechanismsMessage> mechanisms = listMechanisms(
+      service.empty() ? "mesos" : service.c_str(),
+      server.empty() ? NULL : server.c_str(),
+      realm.empty() ? NULL : realm.c_str());
+
+  if (mechanisms.isError()) {
+    return Error(mechanisms.error());
+  }
+
+  process = new GSSAPIAuthenticatorProcess(
+      service,
+      serverPrefix,
+      realm,
+      hostname,
+      localHostname,
+      mechanisms.get(),
+      options);
+
   spawn(process);
 
   return Nothing();
@@ -477,11 +1088,13 @@ Try<Nothing> GSSAPIAuthenticator::initialize(
 
 void GSSAPIAuthenticator::prepare(const string& service_,
                                   const string& serverPrefix_,
-                                  const string& realm_)
+                                  const string& realm_,
+                                  const Options& options_)
 {
   service = service_;
   serverPrefix = serverPrefix_;
   realm = realm_;
+  options = options_;
 }
 
 
@@ -491,13 +1104,7 @@ Future<Option<string>> GSSAPIAuthenticator::authenticate(
   if (process == NULL) {
     return Failure("Authenticator not initialized");
   }
-  return dispatch(
-      process,
-      &GSSAPIAuthenticatorProcess::authenticate,
-      pid,
-      service,
-      serverPrefix,
-      realm);
+  return dispatch(process, &GSSAPIAuthenticatorProcess::authenticate, pid);
 }
 
 } // namespace gssapi {
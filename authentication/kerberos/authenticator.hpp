@@ -18,6 +18,8 @@
 #ifndef __AUTHENTICATION_GSSAPI_AUTHENTICATOR_HPP__
 #define __AUTHENTICATION_GSSAPI_AUTHENTICATOR_HPP__
 
+#include <stddef.h>
+
 #include <string>
 
 #include <mesos/mesos.hpp>
@@ -28,6 +30,7 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
 
@@ -38,16 +41,78 @@ namespace gssapi {
 // Forward declarations.
 class GSSAPIAuthenticatorProcess;
 
+// How often the server hostname gets resolved again when a
+// 'server_prefix' is in use.
+const Duration DEFAULT_HOSTNAME_TTL = Minutes(10);
+
+// How long an authenticatee may take to complete its handshake,
+// counted from its authentication request.
+const Duration DEFAULT_HANDSHAKE_TIMEOUT = Minutes(1);
+
+// Well known ID of the authenticator process when it accepts early
+// starts, so that authenticatees can address their first token to it
+// before having heard from it.
+const char GSSAPI_AUTHENTICATOR_ID[] = "gssapi_authenticator";
+
 class GSSAPIAuthenticator : public Authenticator
 {
 public:
+  // Tuning of the authenticator, independent of SASL.
+  struct Options
+  {
+    Options();
+
+    // Zero disables refreshing the hostname.
+    Duration hostnameTtl;
+
+    // Zero runs SASL calls on the libprocess worker threads.
+    size_t workerThreads;
+
+    // Sessions handshaking at the same time, zero means unlimited.
+    // Further sessions wait in a queue of at most 'maxPendingSessions'
+    // before getting rejected.
+    size_t maxSessions;
+    size_t maxPendingSessions;
+
+    // Time from the authentication request until the handshake must
+    // be complete, including any wait in the queue. Zero disables the
+    // deadline.
+    Duration handshakeTimeout;
+
+    // Whether a new authentication of an authenticatee replaces its
+    // session in progress instead of getting rejected.
+    bool preemptStaleSessions;
+
+    // Whether to take the first token sent along with the
+    // authentication request by an optimistic authenticatee, instead
+    // of offering the mechanisms first. Only one authenticator per
+    // process may accept early starts.
+    bool acceptEarlyStarts;
+
+    // Whether to detect replayed AP-REQs in memory, see ReplayCache,
+    // instead of by the file backed replay cache of Kerberos, which
+    // then gets disabled for the process. The clock skew must match
+    // the one of the realm.
+    bool memoryReplayCache;
+    size_t replayCacheShards;
+    Duration clockSkew;
+
+    // Whether to copy the keytab, 'keytab' or the default one if
+    // empty, into memory, see AcceptorKeytab. It gets checked for a
+    // rotated key every 'keytabReloadInterval', zero disables that.
+    bool preloadKeytab;
+    std::string keytab;
+    Duration keytabReloadInterval;
+  };
+
   GSSAPIAuthenticator();
 
   virtual ~GSSAPIAuthenticator();
 
   void prepare(const std::string& service_,
                const std::string& serverPrefix_,
-               const std::string& realm_);
+               const std::string& realm_,
+               const Options& options_);
 
   virtual Try<Nothing> initialize(const Option<Credentials>& credentials);
 
@@ -60,6 +125,7 @@ private:
   std::string service;
   std::string serverPrefix;
   std::string realm;
+  Options options;
 };
 
 } // namespace cram_md5 {
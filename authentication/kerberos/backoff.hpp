@@ -0,0 +1,68 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_BACKOFF_HPP__
+#define __AUTHENTICATION_GSSAPI_BACKOFF_HPP__
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+
+#include <stout/duration.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Exponential backoff with decorrelated jitter: every delay is drawn
+// uniformly between 'min' and three times the previous one, capped at
+// 'max'. Spreads out the retries of many clients which failed at the
+// same time, e.g., on a failover of the master, rather than having
+// them come back in lockstep. Not thread safe.
+class Backoff
+{
+public:
+  Backoff(const Duration& _min, const Duration& _max)
+    : min(_min),
+      max(std::max(_min, _max)),
+      previous(_min),
+      generator(std::random_device()()) {}
+
+  Duration next()
+  {
+    const int64_t upper =
+      std::min(max.ns(), std::max(min.ns(), previous.ns() * 3));
+
+    std::uniform_int_distribution<int64_t> distribution(min.ns(), upper);
+
+    previous = Nanoseconds(distribution(generator));
+    return previous;
+  }
+
+private:
+  const Duration min;
+  const Duration max;
+  Duration previous;
+  std::minstd_rand generator;
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_GSSAPI_BACKOFF_HPP__
@@ -0,0 +1,370 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <string>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <krb5/krb5.h>
+
+#include <process/async.hpp>
+#include <process/defer.hpp>
+#include <process/delay.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/once.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/try.hpp>
+
+#include "credential_cache.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using namespace process;
+
+using std::set;
+using std::string;
+
+// Prefix of the names of the caches, followed by the principal.
+static const char CACHE_PREFIX[] = "MEMORY:mesos_gssapi_authenticatee/";
+
+// Tickets get acquired again once this much of the lifetime of the
+// shortest lived one passed.
+static const double RENEWAL_FRACTION = 0.75;
+
+// Delay before trying again after a failure to fill the cache.
+static const Duration RETRY_INTERVAL = Seconds(30);
+
+typedef std::pair<string, string> Service; // Service and host.
+
+
+// Owns the Kerberos handles of a fill.
+struct Krb5
+{
+  Krb5() : context(NULL), keytab(NULL), client(NULL), cache(NULL) {}
+
+  ~Krb5()
+  {
+    if (cache != NULL) {
+      krb5_cc_destroy(context, cache);
+    }
+    if (client != NULL) {
+      krb5_free_principal(context, client);
+    }
+    if (keytab != NULL) {
+      krb5_kt_close(context, keytab);
+    }
+    if (context != NULL) {
+      krb5_free_context(context);
+    }
+  }
+
+  Error error(const string& message, krb5_error_code code)
+  {
+    const char* details = krb5_get_error_message(context, code);
+    Error error(message + ": " + details);
+    krb5_free_error_message(context, details);
+    return error;
+  }
+
+  krb5_context context;
+  krb5_keytab keytab;
+  krb5_principal client;
+  krb5_ccache cache;
+};
+
+
+// Acquires all tickets of 'principal' into a fresh cache and then
+// moves that one into place, so that authentications meanwhile keep
+// using the previous tickets. Blocks on the KDC, hence runs via
+// 'async'. Returns the lifetime of the shortest lived ticket.
+static Try<Duration> fill(
+    const string& keytab,
+    const string& principal,
+    const set<Service>& services)
+{
+  Krb5 krb5;
+
+  krb5_error_code code = krb5_init_context(&krb5.context);
+  if (code != 0) {
+    return Error("Failed to initialize Kerberos context");
+  }
+
+  code = keytab.empty()
+    ? krb5_kt_default(krb5.context, &krb5.keytab)
+    : krb5_kt_resolve(krb5.context, keytab.c_str(), &krb5.keytab);
+
+  if (code != 0) {
+    return krb5.error("Failed to resolve keytab", code);
+  }
+
+  // Without a realm the principal belongs to the default one.
+  code = krb5_parse_name(krb5.context, principal.c_str(), &krb5.client);
+  if (code != 0) {
+    return krb5.error("Failed to parse principal '" + principal + "'", code);
+  }
+
+  krb5_creds tgt;
+  code = krb5_get_init_creds_keytab(
+      krb5.context, &tgt, krb5.client, krb5.keytab, 0, NULL, NULL);
+
+  if (code != 0) {
+    return krb5.error("Failed to acquire ticket granting ticket", code);
+  }
+
+  krb5_timestamp expiry = tgt.times.endtime;
+
+  code = krb5_cc_new_unique(krb5.context, "MEMORY", NULL, &krb5.cache);
+  if (code == 0) {
+    code = krb5_cc_initialize(krb5.context, krb5.cache, krb5.client);
+  }
+  if (code == 0) {
+    code = krb5_cc_store_cred(krb5.context, krb5.cache, &tgt);
+  }
+  krb5_free_cred_contents(krb5.context, &tgt);
+
+  if (code != 0) {
+    return krb5.error("Failed to store ticket granting ticket", code);
+  }
+
+  // A master which cannot be served right now should not keep the
+  // others from getting their tickets.
+  foreach (const Service& service, services) {
+    krb5_creds request = krb5_creds();
+    request.client = krb5.client;
+
+    code = krb5_sname_to_principal(
+        krb5.context,
+        service.second.c_str(),
+        service.first.c_str(),
+        KRB5_NT_SRV_HST,
+        &request.server);
+
+    krb5_creds* ticket = NULL;
+    if (code == 0) {
+      code = krb5_get_credentials(
+          krb5.context, 0, krb5.cache, &request, &ticket);
+      krb5_free_principal(krb5.context, request.server);
+    }
+
+    if (code != 0) {
+      LOG(WARNING) << krb5.error(
+          "Failed to acquire service ticket for " +
+          service.first + "@" + service.second, code).message;
+      continue;
+    }
+
+    expiry = std::min(expiry, ticket->times.endtime);
+    krb5_free_creds(krb5.context, ticket);
+  }
+
+  krb5_ccache cache;
+  code = krb5_cc_resolve(
+      krb5.context, CredentialCache::name(principal).c_str(), &cache);
+  if (code != 0) {
+    return krb5.error("Failed to resolve credential cache", code);
+  }
+
+  code = krb5_cc_move(krb5.context, krb5.cache, cache);
+  krb5_cc_close(krb5.context, cache);
+
+  if (code != 0) {
+    return krb5.error("Failed to replace credential cache", code);
+  }
+
+  krb5.cache = NULL; // Got consumed by the move.
+
+  return Seconds(std::max<int64_t>(expiry - ::time(NULL), 0));
+}
+
+
+class CredentialCacheProcess : public Process<CredentialCacheProcess>
+{
+public:
+  explicit CredentialCacheProcess(const string& keytab_)
+    : ProcessBase(ID::generate("gssapi_credential_cache")),
+      keytab(keytab_) {}
+
+  virtual ~CredentialCacheProcess() {}
+
+  void prefetch(const string& service, const string& host)
+  {
+    if (services.insert(Service(service, host)).second) {
+      LOG(INFO) << "Prefetching service ticket for " << service << "@" << host;
+
+      foreachpair (const string& principal, const Owned<Cache>& cache, caches) {
+        refresh(principal, cache->generation);
+      }
+    }
+  }
+
+  Future<Nothing> ready(const string& principal)
+  {
+    if (!caches.contains(principal)) {
+      LOG(INFO) << "Filling credential cache of '" << principal << "'";
+
+      caches.put(principal, Owned<Cache>(new Cache()));
+      refresh(principal, 0);
+    }
+
+    return caches[principal]->filled.future();
+  }
+
+private:
+  struct Cache
+  {
+    Cache() : filling(false), stale(false), generation(0) {}
+
+    bool filling;
+
+    // Whether services got added during the fill in progress.
+    bool stale;
+
+    // Invalidates scheduled refreshes once another one started.
+    uint64_t generation;
+
+    Promise<Nothing> filled;
+  };
+
+  void refresh(const string& principal, uint64_t generation)
+  {
+    Owned<Cache> cache = caches[principal];
+
+    if (generation != cache->generation) {
+      return; // Superseded by an earlier refresh.
+    }
+
+    if (cache->filling) {
+      cache->stale = true; // Services got added meanwhile.
+      return;
+    }
+
+    cache->filling = true;
+
+    async(&fill, keytab, principal, services)
+      .onAny(defer(self(), &Self::_refresh, principal, lambda::_1));
+  }
+
+  void _refresh(const string& principal, const Future<Try<Duration>>& lifetime)
+  {
+    Owned<Cache> cache = caches[principal];
+
+    cache->filling = false;
+
+    Duration next = RETRY_INTERVAL;
+
+    if (!lifetime.isReady() || lifetime.get().isError()) {
+      LOG(WARNING) << "Failed to fill credential cache of '" << principal
+                   << "': "
+                   << (lifetime.isReady()
+                       ? lifetime.get().error()
+                       : lifetime.isFailed()
+                         ? lifetime.failure()
+                         : "discarded");
+    } else {
+      next = std::max(lifetime.get().get() * RENEWAL_FRACTION, RETRY_INTERVAL);
+      LOG(INFO) << "Filled credential cache of '" << principal
+                << "', renewing in " << next;
+    }
+
+    // Let authentications go ahead even after a failure, they would
+    // otherwise wait for the KDC to come back.
+    cache->filled.set(Nothing());
+
+    cache->generation++;
+
+    if (cache->stale) {
+      cache->stale = false;
+      refresh(principal, cache->generation);
+      return;
+    }
+
+    delay(next, self(), &Self::refresh, principal, cache->generation);
+  }
+
+  const string keytab;
+
+  set<Service> services;
+
+  // Caches by principal, never dropped.
+  hashmap<string, Owned<Cache>> caches;
+};
+
+
+static std::atomic<CredentialCacheProcess*> cache(NULL);
+
+
+void CredentialCache::initialize(const string& keytab)
+{
+  static Once* initialize = new Once();
+
+  if (!initialize->once()) {
+    LOG(INFO) << "Using in-memory credential cache filled from keytab '"
+              << (keytab.empty() ? "default" : keytab) << "'";
+
+    CredentialCacheProcess* process_ = new CredentialCacheProcess(keytab);
+    spawn(process_);
+    cache.store(process_);
+
+    initialize->done();
+  }
+}
+
+
+void CredentialCache::prefetch(const string& service, const string& host)
+{
+  CredentialCacheProcess* process_ = cache.load();
+  if (process_ != NULL) {
+    dispatch(process_, &CredentialCacheProcess::prefetch, service, host);
+  }
+}
+
+
+Future<Nothing> CredentialCache::ready(const string& principal)
+{
+  CredentialCacheProcess* process_ = cache.load();
+  if (process_ == NULL) {
+    return Nothing();
+  }
+
+  return dispatch(process_, &CredentialCacheProcess::ready, principal);
+}
+
+
+string CredentialCache::name(const string& principal)
+{
+  return CACHE_PREFIX + principal;
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
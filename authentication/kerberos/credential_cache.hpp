@@ -0,0 +1,67 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_CREDENTIAL_CACHE_HPP__
+#define __AUTHENTICATION_GSSAPI_CREDENTIAL_CACHE_HPP__
+
+#include <string>
+
+#include <process/future.hpp>
+
+#include <stout/nothing.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Process wide in-memory (MEMORY:) credential caches of the
+// authenticatee, one per principal authenticating. Each gets filled
+// from a keytab with a ticket granting ticket for its principal and
+// with service tickets for all masters authenticated against so far,
+// as well as any announced up front. Everything gets acquired again,
+// off the libprocess worker threads, before the shortest lived ticket
+// expires. Authentication hence neither reads a file based cache nor
+// waits for the KDC.
+//
+// The caches are not made the default of the process, authenticatees
+// acquire their credentials from the cache named by 'name'.
+//
+// Process wide as agents create a new authenticatee per attempt.
+class CredentialCache
+{
+public:
+  // Sets up the caches to be filled from 'keytab', the default keytab
+  // if empty. Only the first call has an effect.
+  static void initialize(const std::string& keytab);
+
+  // Adds the ticket for 'service@host' to the caches, if initialized.
+  static void prefetch(const std::string& service, const std::string& host);
+
+  // Completes once the cache of 'principal' got filled for the first
+  // time, right away if not initialized. Starts filling it unless
+  // asked for before.
+  static process::Future<Nothing> ready(const std::string& principal);
+
+  // Name of the cache of 'principal'.
+  static std::string name(const std::string& principal);
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_CREDENTIAL_CACHE_HPP__
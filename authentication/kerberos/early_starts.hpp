@@ -0,0 +1,124 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_EARLY_STARTS_HPP__
+#define __AUTHENTICATION_GSSAPI_EARLY_STARTS_HPP__
+
+#include <stddef.h>
+
+#include <string>
+
+#include <process/clock.hpp>
+#include <process/pid.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// How long an early start is kept around waiting for the
+// authentication request of its authenticatee, and how many of them
+// at most.
+const Duration EARLY_START_TIMEOUT = Seconds(10);
+const size_t MAX_EARLY_STARTS = 1024;
+
+
+// Starts which optimistic authenticatees sent ahead of their
+// authentication request, held by the authenticator until the request
+// arrives. Not thread safe, meant to be owned by a process.
+class EarlyStarts
+{
+public:
+  struct Start
+  {
+    std::string mechanism;
+    std::string data;
+  };
+
+  // Returns false if the start got dropped for lack of room.
+  bool put(const process::UPID& pid,
+           const std::string& mechanism,
+           const std::string& data)
+  {
+    const process::Time now = process::Clock::now();
+
+    if (entries.size() >= MAX_EARLY_STARTS) {
+      // Make room by dropping the ones nobody asked for in time.
+      auto it = entries.begin();
+      while (it != entries.end()) {
+        if (it->second.expiry <= now) {
+          it = entries.erase(it);
+        } else {
+          ++it;
+        }
+      }
+
+      if (entries.size() >= MAX_EARLY_STARTS) {
+        return false;
+      }
+    }
+
+    Entry entry;
+    entry.start.mechanism = mechanism;
+    entry.start.data = data;
+    entry.expiry = now + EARLY_START_TIMEOUT;
+
+    entries.put(pid, entry);
+    return true;
+  }
+
+  // Removes the start of 'pid' and returns it unless expired.
+  Option<Start> take(const process::UPID& pid)
+  {
+    Option<Entry> entry = entries.get(pid);
+    if (entry.isNone()) {
+      return None();
+    }
+
+    entries.erase(pid);
+
+    if (entry.get().expiry <= process::Clock::now()) {
+      return None();
+    }
+
+    return entry.get().start;
+  }
+
+  void clear()
+  {
+    entries.clear();
+  }
+
+private:
+  struct Entry
+  {
+    Start start;
+    process::Time expiry;
+  };
+
+  hashmap<process::UPID, Entry> entries;
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_GSSAPI_EARLY_STARTS_HPP__
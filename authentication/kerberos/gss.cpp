@@ -0,0 +1,185 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <string>
+
+#include <gssapi/gssapi.h>
+#include <gssapi/gssapi_ext.h>
+
+#include <stout/error.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include "gss.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using std::string;
+
+// Appends all messages gss_display_status has for 'code'.
+static void append(OM_uint32 code, int type, string* messages)
+{
+  OM_uint32 context = 0;
+
+  do {
+    OM_uint32 minor;
+    gss_buffer_desc message = GSS_C_EMPTY_BUFFER;
+
+    OM_uint32 major = gss_display_status(
+        &minor, code, type, GSS_C_NO_OID, &context, &message);
+
+    if (GSS_ERROR(major)) {
+      return;
+    }
+
+    if (!messages->empty()) {
+      messages->append(": ");
+    }
+    messages->append(static_cast<const char*>(message.value), message.length);
+
+    gss_release_buffer(&minor, &message);
+  } while (context != 0);
+}
+
+
+string status(OM_uint32 major, OM_uint32 minor)
+{
+  string messages;
+  append(major, GSS_C_GSS_CODE, &messages);
+  if (minor != 0) {
+    append(minor, GSS_C_MECH_CODE, &messages);
+  }
+  return messages;
+}
+
+
+Try<gss_name_t> serviceName(const string& service, const string& host)
+{
+  string principal = service + "@" + host;
+
+  gss_buffer_desc buffer;
+  buffer.value = const_cast<char*>(principal.data());
+  buffer.length = principal.size();
+
+  OM_uint32 minor;
+  gss_name_t name = GSS_C_NO_NAME;
+
+  OM_uint32 major =
+    gss_import_name(&minor, &buffer, GSS_C_NT_HOSTBASED_SERVICE, &name);
+
+  if (GSS_ERROR(major)) {
+    return Error("Failed to import name '" + principal + "': " +
+                 status(major, minor));
+  }
+
+  return name;
+}
+
+
+Try<gss_cred_id_t> acceptorCredential(gss_name_t name, bool replayCache)
+{
+  // The replay cache is a property of the credential, no need to
+  // disable it for the whole process.
+  gss_key_value_element_desc rcache;
+  rcache.key = "rcache";
+  rcache.value = "none:";
+
+  gss_key_value_set_desc store;
+  store.count = 1;
+  store.elements = &rcache;
+
+  gss_cred_id_t credential = GSS_C_NO_CREDENTIAL;
+  OM_uint32 minor;
+
+  OM_uint32 major = gss_acquire_cred_from(
+      &minor,
+      name,
+      GSS_C_INDEFINITE,
+      GSS_C_NO_OID_SET,
+      GSS_C_ACCEPT,
+      replayCache ? GSS_C_NO_CRED_STORE : &store,
+      &credential,
+      NULL,
+      NULL);
+
+  if (GSS_ERROR(major)) {
+    return Error("Failed to acquire acceptor credential: " +
+                 status(major, minor));
+  }
+
+  return credential;
+}
+
+
+Try<gss_cred_id_t> initiatorCredential(
+    const string& principal,
+    const Option<string>& ccache)
+{
+  gss_buffer_desc buffer;
+  buffer.value = const_cast<char*>(principal.data());
+  buffer.length = principal.size();
+
+  OM_uint32 minor;
+  gss_name_t name = GSS_C_NO_NAME;
+
+  OM_uint32 major =
+    gss_import_name(&minor, &buffer, GSS_C_NT_USER_NAME, &name);
+
+  if (GSS_ERROR(major)) {
+    return Error("Failed to import principal '" + principal + "': " +
+                 status(major, minor));
+  }
+
+  // Naming the cache in the store leaves the default one of the
+  // process, i.e., KRB5CCNAME, alone.
+  gss_key_value_element_desc cache;
+  cache.key = "ccache";
+  cache.value = ccache.isSome() ? ccache.get().c_str() : NULL;
+
+  gss_key_value_set_desc store;
+  store.count = 1;
+  store.elements = &cache;
+
+  gss_cred_id_t credential = GSS_C_NO_CREDENTIAL;
+
+  major = gss_acquire_cred_from(
+      &minor,
+      name,
+      GSS_C_INDEFINITE,
+      GSS_C_NO_OID_SET,
+      GSS_C_INITIATE,
+      ccache.isSome() ? &store : GSS_C_NO_CRED_STORE,
+      &credential,
+      NULL,
+      NULL);
+
+  OM_uint32 ignored;
+  gss_release_name(&ignored, &name);
+
+  if (GSS_ERROR(major)) {
+    return Error("Failed to acquire credential of '" + principal + "': " +
+                 status(major, minor));
+  }
+
+  return credential;
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
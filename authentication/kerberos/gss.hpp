@@ -0,0 +1,61 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_GSS_HPP__
+#define __AUTHENTICATION_GSSAPI_GSS_HPP__
+
+#include <string>
+
+#include <gssapi/gssapi.h>
+
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Mechanism offered by the native authenticator. Deliberately not
+// "GSSAPI" as the SASL flavor of the handshake does not interoperate
+// beyond the first token.
+const char NATIVE_GSSAPI_MECHANISM[] = "GSSAPI-NATIVE";
+
+// Renders the GSS-API and mechanism specific messages of a failed
+// call, e.g., "Unspecified GSS failure: Key table entry not found".
+std::string status(OM_uint32 major, OM_uint32 minor);
+
+// Imports 'service@host' as a host based service name.
+Try<gss_name_t> serviceName(const std::string& service,
+                            const std::string& host);
+
+// Acquires the acceptor credential for 'name' from the keytab. Unless
+// 'replayCache', the credential skips the replay cache of Kerberos,
+// for use along with a ReplayCache.
+Try<gss_cred_id_t> acceptorCredential(gss_name_t name, bool replayCache);
+
+// Acquires the initiator credential of 'principal' from the credential
+// cache 'ccache', the default cache (collection) if none. The
+// credential merely refers to the cache, renewed tickets get picked up.
+Try<gss_cred_id_t> initiatorCredential(
+    const std::string& principal,
+    const Option<std::string>& ccache);
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_GSS_HPP__
@@ -23,10 +23,15 @@
 #include <mesos/module/authenticatee.hpp>
 #include <mesos/module/authenticator.hpp>
 
+#include <stout/duration.hpp>
+#include <stout/numify.hpp>
 #include <stout/os.hpp>
+#include <stout/strings.hpp>
 
 #include "authenticatee.hpp"
 #include "authenticator.hpp"
+#include "native_authenticatee.hpp"
+#include "native_authenticator.hpp"
 
 using namespace mesos;
 
@@ -48,31 +53,202 @@ std::string getEnvironment(const std::string& key)
 }
 
 
-static Authenticatee* createGSSAPIAuthenticatee(const Parameters& parameters)
+// Parses the value of 'parameter' into 'value', returns false and
+// logs an error if it is invalid.
+static bool parse(const mesos::Parameter& parameter, Duration* value)
 {
-  mesos::internal::gssapi::GSSAPIAuthenticatee* authenticatee(
-      new mesos::internal::gssapi::GSSAPIAuthenticatee());
+  Try<Duration> duration = Duration::parse(parameter.value());
+  if (duration.isError()) {
+    LOG(ERROR) << "Invalid '" << parameter.key() << "': " << duration.error();
+    return false;
+  }
+  *value = duration.get();
+  return true;
+}
+
+
+static bool parse(const mesos::Parameter& parameter, bool* value)
+{
+  if (parameter.value() == "true") {
+    *value = true;
+  } else if (parameter.value() == "false") {
+    *value = false;
+  } else {
+    LOG(ERROR) << "Invalid '" << parameter.key() << "': Expecting "
+               << "'true' or 'false'";
+    return false;
+  }
+  return true;
+}
+
+
+static bool parse(const mesos::Parameter& parameter, size_t* value)
+{
+  Try<size_t> number = numify<size_t>(parameter.value());
+  if (number.isError()) {
+    LOG(ERROR) << "Invalid '" << parameter.key() << "': " << number.error();
+    return false;
+  }
+  *value = number.get();
+  return true;
+}
+
+
+// Reads the configuration of an authenticatee from the environment,
+// for backwards compatibility, and 'parameters'. Returns false if any
+// of the parameters is invalid.
+static bool parse(
+    const string& module,
+    const Parameters& parameters,
+    string* service,
+    string* serverPrefix,
+    mesos::internal::gssapi::GSSAPIAuthenticatee::Options* options)
+{
+  *service = getEnvironment("SASL_SERVICE_NAME");
+  *serverPrefix = getEnvironment("SASL_SERVER_PREFIX");
+
+  bool valid = true;
+
+  foreach (const mesos::Parameter& parameter, parameters.parameter()) {
+    if (parameter.has_key() && parameter.has_value()) {
+      if (parameter.key() == "service_name") {
+        *service = parameter.value();
+      } else if (parameter.key() == "server_prefix") {
+        *serverPrefix = parameter.value();
+      } else if (parameter.key() == "dns_ttl") {
+        valid = parse(parameter, &options->dnsTtl) && valid;
+      } else if (parameter.key() == "dns_negative_ttl") {
+        valid = parse(parameter, &options->dnsNegativeTtl) && valid;
+      } else if (parameter.key() == "optimistic_start") {
+        valid = parse(parameter, &options->optimisticStart) && valid;
+      } else if (parameter.key() == "credential_cache") {
+        if (parameter.value() == "memory") {
+          options->memoryCredentialCache = true;
+        } else if (parameter.value() == "file") {
+          options->memoryCredentialCache = false;
+        } else {
+          LOG(ERROR) << "Invalid 'credential_cache': Expecting 'file' or "
+                     << "'memory'";
+          valid = false;
+        }
+      } else if (parameter.key() == "keytab") {
+        options->keytab = parameter.value();
+      } else if (parameter.key() == "prefetch_masters") {
+        options->prefetchMasters = strings::tokenize(parameter.value(), ",");
+      } else if (parameter.key() == "handshake_timeout") {
+        valid = parse(parameter, &options->handshakeTimeout) && valid;
+      } else if (parameter.key() == "max_attempts") {
+        valid = parse(parameter, &options->maxAttempts) && valid;
+        if (options->maxAttempts == 0) {
+          LOG(ERROR) << "Invalid 'max_attempts': Expecting at least 1";
+          valid = false;
+        }
+      } else if (parameter.key() == "retry_backoff_min") {
+        valid = parse(parameter, &options->retryBackoffMin) && valid;
+      } else if (parameter.key() == "retry_backoff_max") {
+        valid = parse(parameter, &options->retryBackoffMax) && valid;
+      } else {
+        LOG(WARNING) << module << " does not support a parameter named '"
+                     << parameter.key() << "'";
+      }
+    }
+  }
+
+  return valid;
+}
+
+
+// Reads the configuration of an authenticator from the environment,
+// for backwards compatibility, and 'parameters'. Returns false if any
+// of the parameters is invalid.
+static bool parse(
+    const string& module,
+    const Parameters& parameters,
+    string* service,
+    string* serverPrefix,
+    string* realm,
+    mesos::internal::gssapi::GSSAPIAuthenticator::Options* options)
+{
+  *service = getEnvironment("SASL_SERVICE_NAME");
+  *serverPrefix = getEnvironment("SASL_SERVER_PREFIX");
+  *realm = getEnvironment("SASL_REALM");
 
-  // Get user configuration overrides from the environment for
-  // backwards compatibility.
-  string service = getEnvironment("SASL_SERVICE_NAME");
-  string serverPrefix = getEnvironment("SASL_SERVER_PREFIX");
+  bool valid = true;
 
-  // Get user configuration overrides from the module parameters.
   foreach (const mesos::Parameter& parameter, parameters.parameter()) {
     if (parameter.has_key() && parameter.has_value()) {
       if (parameter.key() == "service_name") {
-        service = parameter.value();
+        *service = parameter.value();
       } else if (parameter.key() == "server_prefix") {
-        serverPrefix = parameter.value();
+        *serverPrefix = parameter.value();
+      } else if (parameter.key() == "realm") {
+        *realm = parameter.value();
+      } else if (parameter.key() == "hostname_ttl") {
+        valid = parse(parameter, &options->hostnameTtl) && valid;
+      } else if (parameter.key() == "worker_threads") {
+        valid = parse(parameter, &options->workerThreads) && valid;
+      } else if (parameter.key() == "max_sessions") {
+        valid = parse(parameter, &options->maxSessions) && valid;
+      } else if (parameter.key() == "max_pending_sessions") {
+        valid = parse(parameter, &options->maxPendingSessions) && valid;
+      } else if (parameter.key() == "handshake_timeout") {
+        valid = parse(parameter, &options->handshakeTimeout) && valid;
+      } else if (parameter.key() == "preempt_stale_sessions") {
+        valid = parse(parameter, &options->preemptStaleSessions) && valid;
+      } else if (parameter.key() == "accept_early_start") {
+        valid = parse(parameter, &options->acceptEarlyStarts) && valid;
+      } else if (parameter.key() == "replay_cache") {
+        if (parameter.value() == "memory") {
+          options->memoryReplayCache = true;
+        } else if (parameter.value() == "file") {
+          options->memoryReplayCache = false;
+        } else {
+          LOG(ERROR) << "Invalid 'replay_cache': Expecting 'file' or 'memory'";
+          valid = false;
+        }
+      } else if (parameter.key() == "replay_cache_shards") {
+        valid = parse(parameter, &options->replayCacheShards) && valid;
+        if (options->replayCacheShards == 0) {
+          LOG(ERROR) << "Invalid 'replay_cache_shards': Expecting at least 1";
+          valid = false;
+        }
+      } else if (parameter.key() == "clock_skew") {
+        valid = parse(parameter, &options->clockSkew) && valid;
+      } else if (parameter.key() == "preload_keytab") {
+        valid = parse(parameter, &options->preloadKeytab) && valid;
+      } else if (parameter.key() == "keytab") {
+        options->keytab = parameter.value();
+      } else if (parameter.key() == "keytab_reload_interval") {
+        valid = parse(parameter, &options->keytabReloadInterval) && valid;
       } else {
-        LOG(WARNING) << "com_mesosphere_mesos_GSSAPIAuthenticatee does not "
-                     << "support a parameter named '" << parameter.key() << "'";
+        LOG(WARNING) << module << " does not support a parameter named '"
+                     << parameter.key() << "'";
       }
     }
   }
 
-  authenticatee->prepare(service, serverPrefix);
+  return valid;
+}
+
+
+static Authenticatee* createGSSAPIAuthenticatee(const Parameters& parameters)
+{
+  string service;
+  string serverPrefix;
+  mesos::internal::gssapi::GSSAPIAuthenticatee::Options options;
+
+  if (!parse("com_mesosphere_mesos_GSSAPIAuthenticatee",
+             parameters,
+             &service,
+             &serverPrefix,
+             &options)) {
+    return NULL;
+  }
+
+  mesos::internal::gssapi::GSSAPIAuthenticatee* authenticatee(
+      new mesos::internal::gssapi::GSSAPIAuthenticatee());
+
+  authenticatee->prepare(service, serverPrefix, options);
 
   return authenticatee;
 }
@@ -90,32 +266,24 @@ mesos::modules::Module<Authenticatee> com_mesosphere_mesos_GSSAPIAuthenticatee(
 
 static Authenticator* createGSSAPIAuthenticator(const Parameters& parameters)
 {
-  mesos::internal::gssapi::GSSAPIAuthenticator* authenticator(
-      new mesos::internal::gssapi::GSSAPIAuthenticator());
-
-  // Get user configuration overrides from the environment for
-  // backwards compatibility.
-  string service = getEnvironment("SASL_SERVICE_NAME");
-  string serverPrefix = getEnvironment("SASL_SERVER_PREFIX");
-  string realm = getEnvironment("SASL_REALM");
+  string service;
+  string serverPrefix;
+  string realm;
+  mesos::internal::gssapi::GSSAPIAuthenticator::Options options;
 
-  // Get user configuration overrides from the module parameters.
-  foreach (const mesos::Parameter& parameter, parameters.parameter()) {
-    if (parameter.has_key() && parameter.has_value()) {
-      if (parameter.key() == "service_name") {
-        service = parameter.value();
-      } else if (parameter.key() == "server_prefix") {
-        serverPrefix = parameter.value();
-      } else if (parameter.key() == "realm") {
-        realm = parameter.value();
-      } else {
-        LOG(WARNING) << "com_mesosphere_mesos_GSSAPIAuthenticator does not "
-                     << "support a parameter named '" << parameter.key() << "'";
-      }
-    }
+  if (!parse("com_mesosphere_mesos_GSSAPIAuthenticator",
+             parameters,
+             &service,
+             &serverPrefix,
+             &realm,
+             &options)) {
+    return NULL;
   }
 
-  authenticator->prepare(service, serverPrefix, realm);
+  mesos::internal::gssapi::GSSAPIAuthenticator* authenticator(
+      new mesos::internal::gssapi::GSSAPIAuthenticator());
+
+  authenticator->prepare(service, serverPrefix, realm, options);
 
   return authenticator;
 }
@@ -129,3 +297,75 @@ mesos::modules::Module<Authenticator> com_mesosphere_mesos_GSSAPIAuthenticator(
     "Kerberos (GSSAPI) SASL authenticator module.",
     compatible,
     createGSSAPIAuthenticator);
+
+
+static Authenticatee* createNativeGSSAPIAuthenticatee(
+    const Parameters& parameters)
+{
+  string service;
+  string serverPrefix;
+  mesos::internal::gssapi::GSSAPIAuthenticatee::Options options;
+
+  if (!parse("com_mesosphere_mesos_NativeGSSAPIAuthenticatee",
+             parameters,
+             &service,
+             &serverPrefix,
+             &options)) {
+    return NULL;
+  }
+
+  mesos::internal::gssapi::NativeGSSAPIAuthenticatee* authenticatee(
+      new mesos::internal::gssapi::NativeGSSAPIAuthenticatee());
+
+  authenticatee->prepare(service, serverPrefix, options);
+
+  return authenticatee;
+}
+
+
+mesos::modules::Module<Authenticatee>
+com_mesosphere_mesos_NativeGSSAPIAuthenticatee(
+    MESOS_MODULE_API_VERSION,
+    MESOS_VERSION,
+    "Mesosphere",
+    "till@mesosphere.io",
+    "Kerberos GSS-API authenticatee module, bypassing SASL.",
+    compatible,
+    createNativeGSSAPIAuthenticatee);
+
+
+static Authenticator* createNativeGSSAPIAuthenticator(
+    const Parameters& parameters)
+{
+  string service;
+  string serverPrefix;
+  string realm;
+  mesos::internal::gssapi::GSSAPIAuthenticator::Options options;
+
+  if (!parse("com_mesosphere_mesos_NativeGSSAPIAuthenticator",
+             parameters,
+             &service,
+             &serverPrefix,
+             &realm,
+             &options)) {
+    return NULL;
+  }
+
+  mesos::internal::gssapi::NativeGSSAPIAuthenticator* authenticator(
+      new mesos::internal::gssapi::NativeGSSAPIAuthenticator());
+
+  authenticator->prepare(service, serverPrefix, realm, options);
+
+  return authenticator;
+}
+
+
+mesos::modules::Module<Authenticator>
+com_mesosphere_mesos_NativeGSSAPIAuthenticator(
+    MESOS_MODULE_API_VERSION,
+    MESOS_VERSION,
+    "Mesosphere",
+    "till@mesosphere.io",
+    "Kerberos GSS-API authenticator module, bypassing SASL.",
+    compatible,
+    createNativeGSSAPIAuthenticator);
@@ -0,0 +1,100 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_METRICS_HPP__
+#define __AUTHENTICATION_GSSAPI_METRICS_HPP__
+
+#include <memory>
+#include <string>
+
+#include <sasl/sasl.h>
+
+#include <process/future.hpp>
+
+#include <process/metrics/timer.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/stringify.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Measures a phase of a handshake with 'timer'. Unlike Timer::start
+// and Timer::stop this allows for many handshakes being in the same
+// phase at once. Phases which never end, e.g., as the handshake
+// failed, do not get recorded.
+class Phase
+{
+public:
+  void start(process::metrics::Timer<Milliseconds>& timer)
+  {
+    promise.reset(new process::Promise<Nothing>());
+    timer.time(promise->future());
+  }
+
+  void stop()
+  {
+    if (promise) {
+      promise->set(Nothing());
+      promise.reset();
+    }
+  }
+
+private:
+  std::unique_ptr<process::Promise<Nothing>> promise;
+};
+
+
+// Returns the name of a SASL result code for use in metric names,
+// e.g., "badauth" for SASL_BADAUTH.
+inline std::string saslResultName(int result)
+{
+  switch (result) {
+    case SASL_FAIL:      return "fail";
+    case SASL_NOMEM:     return "nomem";
+    case SASL_BUFOVER:   return "bufover";
+    case SASL_NOMECH:    return "nomech";
+    case SASL_BADPROT:   return "badprot";
+    case SASL_NOTDONE:   return "notdone";
+    case SASL_BADPARAM:  return "badparam";
+    case SASL_TRYAGAIN:  return "tryagain";
+    case SASL_BADMAC:    return "badmac";
+    case SASL_BADSERV:   return "badserv";
+    case SASL_WRONGMECH: return "wrongmech";
+    case SASL_NOTINIT:   return "notinit";
+    case SASL_BADAUTH:   return "badauth";
+    case SASL_NOAUTHZ:   return "noauthz";
+    case SASL_TOOWEAK:   return "tooweak";
+    case SASL_ENCRYPT:   return "encrypt";
+    case SASL_TRANS:     return "trans";
+    case SASL_EXPIRED:   return "expired";
+    case SASL_DISABLED:  return "disabled";
+    case SASL_NOUSER:    return "nouser";
+    case SASL_BADVERS:   return "badvers";
+    case SASL_UNAVAIL:   return "unavail";
+    case SASL_NOVERIFY:  return "noverify";
+    default:             return stringify(result);
+  }
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_GSSAPI_METRICS_HPP__
@@ -0,0 +1,753 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <gssapi/gssapi.h>
+
+#include <mesos/mesos.hpp>
+
+#include <process/defer.hpp>
+#include <process/delay.hpp>
+#include <process/id.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+#include <stout/try.hpp>
+
+#include "authenticator.hpp"
+#include "backoff.hpp"
+#include "credential_cache.hpp"
+#include "gss.hpp"
+#include "native_authenticatee.hpp"
+#include "resolver.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using namespace process;
+
+using std::shared_ptr;
+using std::string;
+
+// Like its SASL flavor, a single process serves all authentications,
+// one attempt per master at a time. Initiator credentials and target
+// names outlive the attempts, only the security context is per
+// attempt.
+class NativeGSSAPIAuthenticateeProcess
+  : public ProtobufProcess<NativeGSSAPIAuthenticateeProcess>
+{
+public:
+  NativeGSSAPIAuthenticateeProcess(
+      const string& service_,
+      const string& serverPrefix_,
+      const GSSAPIAuthenticatee::Options& options_)
+    : ProcessBase(ID::generate("native_authenticatee")),
+      service(service_),
+      serverPrefix(serverPrefix_),
+      options(options_),
+      attemptId(0) {}
+
+  virtual ~NativeGSSAPIAuthenticateeProcess()
+  {
+    OM_uint32 minor;
+
+    foreachvalue (gss_name_t target, targets) {
+      gss_release_name(&minor, &target);
+    }
+
+    foreachvalue (gss_cred_id_t credential, credentials) {
+      gss_release_cred(&minor, &credential);
+    }
+  }
+
+  virtual void finalize()
+  {
+    foreachvalue (const shared_ptr<Attempt>& attempt, attempts) {
+      attempt->status = Attempt::DISCARDED;
+      attempt->promise.fail("Authentication discarded");
+    }
+
+    attempts.clear();
+  }
+
+  Future<bool> authenticate(
+      const UPID& pid,
+      const UPID& client,
+      const string& principal)
+  {
+    const string key = stringify(pid.address);
+
+    Option<shared_ptr<Attempt>> previous = attempts.get(key);
+    if (previous.isSome()) {
+      LOG(INFO) << "Superseding authentication in flight against " << pid;
+      fail(previous.get(), "Authentication superseded by a new attempt");
+    }
+
+    shared_ptr<Attempt> attempt(new Attempt(
+        attemptId++,
+        pid,
+        client,
+        principal,
+        Backoff(options.retryBackoffMin, options.retryBackoffMax)));
+
+    attempts.put(key, attempt);
+
+    // Stop authenticating if nobody cares.
+    Future<bool> future = attempt->promise.future();
+    future.onDiscard(defer(self(), &Self::discarded, key, attempt->id));
+
+    // Tickets right after startup come from the credential cache, if
+    // any, once it got filled.
+    CredentialCache::ready(principal)
+      .onAny(defer(self(), &Self::resolve, key, attempt->id));
+
+    return future;
+  }
+
+  // Starts a handshake of the attempt.
+  void resolve(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(key, id);
+    if (attempt_.isNone() || attempt_.get()->status != Attempt::READY) {
+      return; // Superseded or discarded meanwhile.
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    const size_t handshake = ++attempt->handshakes;
+
+    if (options.handshakeTimeout > Seconds(0)) {
+      delay(options.handshakeTimeout,
+            self(),
+            &Self::timeout,
+            key,
+            id,
+            handshake);
+    }
+
+    // Resolve server's hostname from pid ip, without blocking this
+    // process on the resolver.
+    Resolver::hostname(
+        attempt->pid.address.ip,
+        options.dnsTtl,
+        options.dnsNegativeTtl)
+      .onAny(defer(self(),
+                   &Self::_authenticate,
+                   key,
+                   id,
+                   handshake,
+                   lambda::_1));
+  }
+
+  void _authenticate(
+      const string& key,
+      uint64_t id,
+      size_t handshake,
+      const Future<string>& hostname)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(key, id);
+    if (attempt_.isNone() ||
+        attempt_.get()->handshakes != handshake ||
+        attempt_.get()->status != Attempt::READY) {
+      return; // Superseded, discarded or timed out meanwhile.
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (!hostname.isReady()) {
+      retry(attempt,
+           "Failed to resolve hostname: " +
+           (hostname.isFailed() ? hostname.failure() : "discarded"));
+      return;
+    }
+
+    const string server = serverPrefix + hostname.get();
+    LOG(INFO) << "Authenticating against server: " << server;
+
+    // Keep the service ticket of this master fresh for next time.
+    CredentialCache::prefetch(service.empty() ? "mesos" : service, server);
+
+    Try<gss_name_t> target = this->target(server);
+    if (target.isError()) {
+      retry(attempt, target.error());
+      return;
+    }
+
+    attempt->target = target.get();
+
+    Try<gss_cred_id_t> credential = acquire(attempt->principal);
+    if (credential.isError()) {
+      retry(attempt, credential.error());
+      return;
+    }
+
+    attempt->credential = credential.get();
+
+    // The AP-REQ only depends on the target, hence gets created right
+    // away; it is either sent along with the request or once the
+    // mechanism got offered.
+    Try<bool> complete = init(attempt, None(), &attempt->token);
+    if (complete.isError()) {
+      retry(attempt, complete.error());
+      return;
+    }
+
+    if (options.optimisticStart) {
+      AuthenticationStartMessage message;
+      message.set_mechanism(NATIVE_GSSAPI_MECHANISM);
+      message.set_data(attempt->token);
+      send(UPID(GSSAPI_AUTHENTICATOR_ID, attempt->pid.address), message);
+    }
+
+    AuthenticateMessage message;
+    message.set_pid(attempt->client);
+    send(attempt->pid, message);
+
+    attempt->status = options.optimisticStart
+      ? Attempt::EARLY
+      : Attempt::STARTING;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticationMechanismsMessage>(
+        &NativeGSSAPIAuthenticateeProcess::mechanisms,
+        &AuthenticationMechanismsMessage::mechanisms);
+
+    install<AuthenticationStepMessage>(
+        &NativeGSSAPIAuthenticateeProcess::step,
+        &AuthenticationStepMessage::data);
+
+    install<AuthenticationCompletedMessage>(
+        &NativeGSSAPIAuthenticateeProcess::completed);
+
+    install<AuthenticationFailedMessage>(
+        &NativeGSSAPIAuthenticateeProcess::failed);
+
+    install<AuthenticationErrorMessage>(
+        &NativeGSSAPIAuthenticateeProcess::error,
+        &AuthenticationErrorMessage::error);
+  }
+
+  void mechanisms(const UPID& from, const std::vector<string>& mechanisms)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (attempt->status == Attempt::EARLY) {
+      // The authenticator did not take our early start, the AP-REQ
+      // did not get consumed and can simply be sent again.
+      LOG(INFO) << "Early authentication start not accepted";
+      attempt->status = Attempt::STARTING;
+    }
+
+    if (attempt->status != Attempt::STARTING) {
+      retry(attempt, "Unexpected authentication 'mechanisms' received");
+      return;
+    }
+
+    LOG(INFO) << "Received authentication mechanisms: "
+              << strings::join(",", mechanisms);
+
+    if (std::find(mechanisms.begin(),
+                  mechanisms.end(),
+                  NATIVE_GSSAPI_MECHANISM) == mechanisms.end()) {
+      fail(attempt,
+           string("Authenticator does not offer ") + NATIVE_GSSAPI_MECHANISM);
+      return;
+    }
+
+    AuthenticationStartMessage message;
+    message.set_mechanism(NATIVE_GSSAPI_MECHANISM);
+    message.set_data(attempt->token);
+    send(from, message);
+
+    attempt->status = Attempt::STEPPING;
+  }
+
+  void step(const UPID& from, const string& data)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (attempt->status == Attempt::EARLY) {
+      // The authenticator took our early start.
+      attempt->status = Attempt::STEPPING;
+    }
+
+    if (attempt->status != Attempt::STEPPING) {
+      retry(attempt, "Unexpected authentication 'step' received");
+      return;
+    }
+
+    string output;
+    Try<bool> complete = init(attempt, data, &output);
+    if (complete.isError()) {
+      retry(attempt, complete.error());
+      return;
+    }
+
+    if (!output.empty()) {
+      AuthenticationStepMessage message;
+      message.set_data(output);
+      send(from, message);
+    }
+
+    if (complete.get()) {
+      attempt->status = Attempt::ESTABLISHED;
+    }
+  }
+
+  void completed(const UPID& from)
+  {
+    Option<shared_ptr<Attempt>> attempt_ = find(from);
+    if (attempt_.isNone()) {
+      return;
+    }
+
+    shared_ptr<Attempt> attempt = attempt_.get();
+
+    if (attempt->status != Attempt::ESTABLISHED) {
+      retry(attempt,
+            "Unexpected authentication 'completed' received before "
+            "mutual authentication");
+      return;
+    }
+
+    LOG(INFO) << "Authentication success";
+
+    attempt->status = Attempt::COMPLETED;
+    attempt->promise.set(true);
+    attempts.erase(stringify(from.address));
+  }
+
+  void failed(const UPID& from)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(from);
+    if (attempt.isSome()) {
+      attempt.get()->status = Attempt::FAILED;
+      attempt.get()->promise.set(false);
+      attempts.erase(stringify(from.address));
+    }
+  }
+
+  void error(const UPID& from, const string& error)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(from);
+    if (attempt.isSome()) {
+      retry(attempt.get(), "Authentication error: " + error);
+    }
+  }
+
+  void timeout(const string& key, uint64_t id, size_t handshake)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(key, id);
+    if (attempt.isSome() &&
+        attempt.get()->handshakes == handshake &&
+        attempt.get()->status != Attempt::WAITING) {
+      retry(attempt.get(),
+            "Authentication timed out after " +
+            stringify(options.handshakeTimeout));
+    }
+  }
+
+  // Starts another handshake once backed off.
+  void resume(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(key, id);
+    if (attempt.isSome() && attempt.get()->status == Attempt::WAITING) {
+      attempt.get()->status = Attempt::READY;
+      resolve(key, id);
+    }
+  }
+
+  void discarded(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt = find(key, id);
+    if (attempt.isSome()) {
+      attempt.get()->status = Attempt::DISCARDED;
+      attempt.get()->promise.fail("Authentication discarded");
+      attempts.erase(key);
+    }
+  }
+
+private:
+  // State of a single authentication, dropped once it ended. The
+  // credential and target are borrowed from the process.
+  struct Attempt
+  {
+    Attempt(uint64_t _id,
+            const UPID& _pid,
+            const UPID& _client,
+            const string& _principal,
+            const Backoff& _backoff)
+      : id(_id),
+        pid(_pid),
+        client(_client),
+        principal(_principal),
+        handshakes(0),
+        backoff(_backoff),
+        status(READY),
+        credential(GSS_C_NO_CREDENTIAL),
+        target(GSS_C_NO_NAME),
+        context(GSS_C_NO_CONTEXT) {}
+
+    ~Attempt()
+    {
+      if (context != GSS_C_NO_CONTEXT) {
+        OM_uint32 minor;
+        gss_delete_sec_context(&minor, &context, GSS_C_NO_BUFFER);
+      }
+    }
+
+    const uint64_t id;
+
+    // PID of the master.
+    const UPID pid;
+
+    // PID of the client that needs to be authenticated.
+    const UPID client;
+
+    const string principal;
+
+    // Handshakes started so far.
+    size_t handshakes;
+    Backoff backoff;
+
+    enum {
+      READY,
+      WAITING,      // Backing off before another handshake.
+      EARLY,        // Sent our AP-REQ along with the request.
+      STARTING,
+      STEPPING,
+      ESTABLISHED,  // Verified the AP-REP of the authenticator.
+      COMPLETED,
+      FAILED,
+      ERROR,
+      DISCARDED
+    } status;
+
+    gss_cred_id_t credential;
+    gss_name_t target;
+    gss_ctx_id_t context;
+
+    // Our AP-REQ.
+    string token;
+
+    Promise<bool> promise;
+  };
+
+  // Looks up the attempt against the master at the address 'from'
+  // came from. Messages in between handshakes belong to an abandoned
+  // one and get ignored.
+  Option<shared_ptr<Attempt>> find(const UPID& from)
+  {
+    Option<shared_ptr<Attempt>> attempt =
+      attempts.get(stringify(from.address));
+
+    if (attempt.isNone()) {
+      LOG(WARNING) << "Ignoring authentication message from " << from
+                   << " without an attempt in flight";
+      return None();
+    }
+
+    if (attempt.get()->status == Attempt::READY ||
+        attempt.get()->status == Attempt::WAITING) {
+      LOG(WARNING) << "Ignoring authentication message from " << from
+                   << " in between handshakes";
+      return None();
+    }
+
+    return attempt;
+  }
+
+  Option<shared_ptr<Attempt>> find(const string& key, uint64_t id)
+  {
+    Option<shared_ptr<Attempt>> attempt = attempts.get(key);
+    if (attempt.isSome() && attempt.get()->id == id) {
+      return attempt;
+    }
+    return None();
+  }
+
+  // Fails 'attempt' and drops it.
+  void fail(const shared_ptr<Attempt>& attempt, const string& message)
+  {
+    attempt->status = Attempt::ERROR;
+    attempt->promise.fail(message);
+
+    const string key = stringify(attempt->pid.address);
+    if (find(key, attempt->id).isSome()) {
+      attempts.erase(key);
+    }
+  }
+
+  // Fails 'attempt' unless it has handshakes left, in which case
+  // another one starts after backing off, with a new security
+  // context.
+  void retry(const shared_ptr<Attempt>& attempt, const string& message)
+  {
+    if (attempt->handshakes >= options.maxAttempts) {
+      fail(attempt, message);
+      return;
+    }
+
+    const Duration backoff = attempt->backoff.next();
+
+    LOG(WARNING) << message << "; trying again in " << backoff
+                 << " (handshake " << attempt->handshakes << " of "
+                 << options.maxAttempts << ")";
+
+    if (attempt->context != GSS_C_NO_CONTEXT) {
+      OM_uint32 minor;
+      gss_delete_sec_context(&minor, &attempt->context, GSS_C_NO_BUFFER);
+    }
+
+    attempt->token.clear();
+    attempt->status = Attempt::WAITING;
+
+    delay(backoff,
+          self(),
+          &Self::resume,
+          stringify(attempt->pid.address),
+          attempt->id);
+  }
+
+  // Returns the name of the service at 'server', imported once.
+  Try<gss_name_t> target(const string& server)
+  {
+    Option<gss_name_t> target = targets.get(server);
+    if (target.isSome()) {
+      return target.get();
+    }
+
+    Try<gss_name_t> name =
+      serviceName(service.empty() ? "mesos" : service, server);
+
+    if (name.isSome()) {
+      targets.put(server, name.get());
+    }
+
+    return name;
+  }
+
+  // Acquires the initiator credential of 'principal' from its ticket
+  // cache, once.
+  Try<gss_cred_id_t> acquire(const string& principal)
+  {
+    Option<gss_cred_id_t> cached = credentials.get(principal);
+    if (cached.isSome()) {
+      return cached.get();
+    }
+
+    Try<gss_cred_id_t> credential = initiatorCredential(
+        principal,
+        options.memoryCredentialCache
+          ? CredentialCache::name(principal)
+          : Option<string>::none());
+
+    if (credential.isSome()) {
+      credentials.put(principal, credential.get());
+    }
+
+    return credential;
+  }
+
+  // Advances the security context of 'attempt' with the token of the
+  // authenticator, if any. Returns whether the context got
+  // established, i.e., whether the authenticator proved its identity.
+  Try<bool> init(
+      const shared_ptr<Attempt>& attempt,
+      const Option<string>& input,
+      string* output)
+  {
+    gss_buffer_desc input_;
+    if (input.isSome()) {
+      input_.value = const_cast<char*>(input.get().data());
+      input_.length = input.get().size();
+    }
+
+    gss_buffer_desc output_ = GSS_C_EMPTY_BUFFER;
+    OM_uint32 minor;
+
+    OM_uint32 major = gss_init_sec_context(
+        &minor,
+        attempt->credential,
+        &attempt->context,
+        attempt->target,
+        GSS_C_NO_OID,      // Default mechanism, i.e., Kerberos.
+        GSS_C_MUTUAL_FLAG,
+        0,                 // Default lifetime.
+        GSS_C_NO_CHANNEL_BINDINGS,
+        input.isSome() ? &input_ : GSS_C_NO_BUFFER,
+        NULL,              // Actual mechanism.
+        &output_,
+        NULL,              // Actual flags.
+        NULL);             // Lifetime of the context.
+
+    output->assign(static_cast<const char*>(output_.value), output_.length);
+
+    OM_uint32 ignored;
+    gss_release_buffer(&ignored, &output_);
+
+    if (GSS_ERROR(major)) {
+      return Error("Failed to initialize security context: " +
+                   status(major, minor));
+    }
+
+    return major == GSS_S_COMPLETE;
+  }
+
+  const string service;
+  const string serverPrefix;
+  const GSSAPIAuthenticatee::Options options;
+
+  // Initiator credentials by principal.
+  hashmap<string, gss_cred_id_t> credentials;
+
+  // Names of the services by server.
+  hashmap<string, gss_name_t> targets;
+
+  uint64_t attemptId;
+
+  // Attempts in flight, by the address of their master.
+  hashmap<string, shared_ptr<Attempt>> attempts;
+};
+
+
+// Returns the process shared by the authenticatees of 'key', spawning
+// it for the first one.
+static NativeGSSAPIAuthenticateeProcess* shared(
+    const string& key,
+    const string& service,
+    const string& serverPrefix,
+    const GSSAPIAuthenticatee::Options& options)
+{
+  static std::mutex* mutex = new std::mutex();
+  static hashmap<string, NativeGSSAPIAuthenticateeProcess*>* processes =
+    new hashmap<string, NativeGSSAPIAuthenticateeProcess*>();
+
+  std::lock_guard<std::mutex> lock(*mutex);
+
+  Option<NativeGSSAPIAuthenticateeProcess*> process = processes->get(key);
+  if (process.isSome()) {
+    return process.get();
+  }
+
+  NativeGSSAPIAuthenticateeProcess* process_ =
+    new NativeGSSAPIAuthenticateeProcess(service, serverPrefix, options);
+  spawn(process_);
+  processes->put(key, process_);
+
+  return process_;
+}
+
+
+NativeGSSAPIAuthenticatee::NativeGSSAPIAuthenticatee()
+  : process(NULL) {}
+
+
+NativeGSSAPIAuthenticatee::~NativeGSSAPIAuthenticatee()
+{
+  // The process is shared with later authenticatees of the client,
+  // only the authentications of this one end along with it.
+  foreach (Future<bool> future, authentications) {
+    future.discard();
+  }
+}
+
+
+void NativeGSSAPIAuthenticatee::prepare(
+    const string& service_,
+    const string& serverPrefix_,
+    const GSSAPIAuthenticatee::Options& options_)
+{
+  service = service_;
+  serverPrefix = serverPrefix_;
+  options = options_;
+
+  if (options.memoryCredentialCache) {
+    CredentialCache::initialize(options.keytab);
+
+    foreach (const string& master, options.prefetchMasters) {
+      CredentialCache::prefetch(
+          service.empty() ? "mesos" : service,
+          serverPrefix + master);
+    }
+  }
+}
+
+
+Future<bool> NativeGSSAPIAuthenticatee::authenticate(
+  const UPID& pid,
+  const UPID& client,
+  const mesos::Credential& credential)
+{
+  CHECK(credential.has_principal());
+
+  if (process == NULL) {
+    process = shared(
+        sharedProcessKey(client, service, serverPrefix, options),
+        service,
+        serverPrefix,
+        options);
+  }
+
+  // Forget about the authentications which ended meanwhile.
+  authentications.erase(
+      std::remove_if(
+          authentications.begin(),
+          authentications.end(),
+          [](const Future<bool>& future) { return !future.isPending(); }),
+      authentications.end());
+
+  Future<bool> future = dispatch(
+      process,
+      &NativeGSSAPIAuthenticateeProcess::authenticate,
+      pid,
+      client,
+      credential.principal());
+
+  authentications.push_back(future);
+
+  return future;
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,77 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_NATIVE_AUTHENTICATEE_HPP__
+#define __AUTHENTICATION_GSSAPI_NATIVE_AUTHENTICATEE_HPP__
+
+#include <string>
+#include <vector>
+
+#include <mesos/authentication/authenticatee.hpp>
+
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include "authenticatee.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Forward declaration.
+class NativeGSSAPIAuthenticateeProcess;
+
+// Counterpart of the NativeGSSAPIAuthenticator, takes the same
+// options as the SASL flavor. The principal of the credential selects
+// the ticket cache to use. Completion only gets accepted once the
+// authenticator proved its identity with its AP-REP.
+class NativeGSSAPIAuthenticatee : public Authenticatee
+{
+public:
+  NativeGSSAPIAuthenticatee();
+
+  virtual ~NativeGSSAPIAuthenticatee();
+
+  void prepare(const std::string& service,
+               const std::string& serverPrefix,
+               const GSSAPIAuthenticatee::Options& options);
+
+  // Reusable like GSSAPIAuthenticatee::authenticate.
+  virtual process::Future<bool> authenticate(
+    const process::UPID& pid,
+    const process::UPID& clientPid,
+    const mesos::Credential& credential);
+
+private:
+  // Shared with the other authenticatees of the client, never deleted,
+  // see 'sharedProcessKey'.
+  NativeGSSAPIAuthenticateeProcess* process;
+
+  // Authentications of this authenticatee which may still be in
+  // flight, discarded along with it.
+  std::vector<process::Future<bool>> authentications;
+
+  std::string service;
+  std::string serverPrefix;
+  GSSAPIAuthenticatee::Options options;
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_NATIVE_AUTHENTICATEE_HPP__
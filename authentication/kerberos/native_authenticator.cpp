@@ -0,0 +1,503 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <memory>
+#include <string>
+
+#include <gssapi/gssapi.h>
+
+#include <mesos/mesos.hpp>
+
+#include <mesos/module/authenticator.hpp>
+
+#include <process/defer.hpp>
+#include <process/delay.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/net.hpp>
+#include <stout/strings.hpp>
+
+#include "acceptor_keytab.hpp"
+#include "early_starts.hpp"
+#include "gss.hpp"
+#include "native_authenticator.hpp"
+#include "replay_cache.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using namespace process;
+
+using std::shared_ptr;
+using std::string;
+
+// Runs all sessions within a single process, like its SASL flavor.
+// A session only lives from the authentication request until the
+// authenticatee sent its AP-REQ; with an early start the whole
+// handshake happens right on the request.
+class NativeGSSAPIAuthenticatorProcess
+  : public ProtobufProcess<NativeGSSAPIAuthenticatorProcess>
+{
+public:
+  NativeGSSAPIAuthenticatorProcess(
+      const string& realm_,
+      gss_name_t name_,
+      gss_cred_id_t credential_,
+      const GSSAPIAuthenticator::Options& options_) :
+    ProcessBase(options_.acceptEarlyStarts
+                  ? GSSAPI_AUTHENTICATOR_ID
+                  : ID::generate("native_gssapi_authenticator")),
+    realm(realm_),
+    name(name_),
+    credential(credential_),
+    keytabGeneration(AcceptorKeytab::generation()),
+    options(options_),
+    replays(options.memoryReplayCache
+              ? new ReplayCache(options.replayCacheShards, options.clockSkew)
+              : NULL),
+    sessionId(0) {}
+
+  virtual ~NativeGSSAPIAuthenticatorProcess()
+  {
+    OM_uint32 minor;
+    gss_release_cred(&minor, &credential);
+    gss_release_name(&minor, &name);
+  }
+
+  virtual void finalize()
+  {
+    foreachvalue (const shared_ptr<Session>& session, sessions) {
+      session->promise.fail("Authentication discarded");
+    }
+
+    sessions.clear();
+    earlyStarts.clear();
+  }
+
+  Future<Option<string>> authenticate(const UPID& pid)
+  {
+    VLOG(1) << "Starting authentication session for " << pid;
+
+    Option<shared_ptr<Session>> stale = sessions.get(pid);
+    if (stale.isSome()) {
+      if (!options.preemptStaleSessions) {
+        return Failure("Authentication session already active for " +
+                       string(pid));
+      }
+
+      LOG(INFO) << "Preempting stale authentication session for " << pid;
+      stale.get()->promise.fail("Authentication superseded by a new attempt");
+      sessions.erase(pid);
+    }
+
+    if (options.maxSessions > 0 && sessions.size() >= options.maxSessions) {
+      const string error = "Too many authentication sessions";
+      LOG(WARNING) << "Rejecting authentication of " << pid << ": " << error;
+      AuthenticationErrorMessage message;
+      message.set_error(error);
+      send(pid, message);
+      return Failure(error);
+    }
+
+    shared_ptr<Session> session(new Session(pid, sessionId++));
+
+    link(pid); // Don't bother waiting for a lost authenticatee.
+
+    sessions.put(pid, session);
+
+    // Stop authenticating if nobody cares. The session id guards
+    // against discarding a later session of the same authenticatee.
+    Future<Option<string>> future = session->promise.future();
+    future.onDiscard(defer(self(), &Self::discarded, pid, session->id));
+
+    if (options.handshakeTimeout > Duration::zero()) {
+      delay(options.handshakeTimeout,
+            self(),
+            &Self::timeout,
+            pid,
+            session->id);
+    }
+
+    Option<EarlyStarts::Start> early = earlyStarts.take(pid);
+    if (early.isSome() && early.get().mechanism == NATIVE_GSSAPI_MECHANISM) {
+      LOG(INFO) << "Received early authentication start from " << pid;
+      accept(session, early.get().data);
+      return future;
+    }
+
+    AuthenticationMechanismsMessage message;
+    message.add_mechanisms(NATIVE_GSSAPI_MECHANISM);
+    send(pid, message);
+
+    return future;
+  }
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticationStartMessage>(
+        &NativeGSSAPIAuthenticatorProcess::start,
+        &AuthenticationStartMessage::mechanism,
+        &AuthenticationStartMessage::data);
+
+    install<AuthenticationStepMessage>(
+        &NativeGSSAPIAuthenticatorProcess::step,
+        &AuthenticationStepMessage::data);
+  }
+
+  virtual void exited(const UPID& pid)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isSome()) {
+      session.get()->promise.fail("Failed to communicate with authenticatee");
+      sessions.erase(pid);
+    }
+  }
+
+  void start(const UPID& from, const string& mechanism, const string& data)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(from);
+    if (session.isNone()) {
+      if (options.acceptEarlyStarts) {
+        // The authentication request is right behind.
+        if (!earlyStarts.put(from, mechanism, data)) {
+          LOG(WARNING) << "Dropping early authentication start from "
+                       << from << ", too many pending";
+        }
+        return;
+      }
+
+      LOG(WARNING) << "Ignoring authentication 'start' from " << from
+                   << " without an active session";
+      return;
+    }
+
+    if (session.get()->context != GSS_C_NO_CONTEXT) {
+      error(session.get(), "Unexpected authentication 'start' received");
+      return;
+    }
+
+    if (mechanism != NATIVE_GSSAPI_MECHANISM) {
+      error(session.get(), "Unsupported mechanism '" + mechanism + "'");
+      return;
+    }
+
+    accept(session.get(), data);
+  }
+
+  void step(const UPID& from, const string& data)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(from);
+    if (session.isNone()) {
+      LOG(WARNING) << "Ignoring authentication 'step' from " << from
+                   << " without an active session";
+      return;
+    }
+
+    if (session.get()->context == GSS_C_NO_CONTEXT) {
+      error(session.get(), "Unexpected authentication 'step' received");
+      return;
+    }
+
+    accept(session.get(), data);
+  }
+
+  void discarded(const UPID& pid, uint64_t id)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isSome() && session.get()->id == id) {
+      session.get()->promise.fail("Authentication discarded");
+      sessions.erase(pid);
+    }
+  }
+
+  void timeout(const UPID& pid, uint64_t id)
+  {
+    Option<shared_ptr<Session>> session = sessions.get(pid);
+    if (session.isSome() && session.get()->id == id) {
+      LOG(WARNING) << "Authentication of " << pid << " timed out after "
+                   << options.handshakeTimeout;
+      error(session.get(), "Authentication timed out");
+    }
+  }
+
+private:
+  struct Session
+  {
+    Session(const UPID& _pid, uint64_t _id)
+      : pid(_pid), id(_id), context(GSS_C_NO_CONTEXT) {}
+
+    ~Session()
+    {
+      if (context != GSS_C_NO_CONTEXT) {
+        OM_uint32 minor;
+        gss_delete_sec_context(&minor, &context, GSS_C_NO_BUFFER);
+      }
+    }
+
+    const UPID pid;
+    const uint64_t id;
+
+    // Established by the first token, i.e., the start.
+    gss_ctx_id_t context;
+
+    // The first token, i.e., the AP-REQ, for the replay detection.
+    string token;
+
+    Promise<Option<string>> promise;
+  };
+
+  // Feeds a token of the authenticatee into the security context. The
+  // Kerberos mechanism completes on the AP-REQ, its AP-REP for the
+  // mutual authentication gets sent as a step followed by the
+  // completion.
+  void accept(shared_ptr<Session> session, const string& data)
+  {
+    if (session->context == GSS_C_NO_CONTEXT) {
+      session->token = data;
+    }
+
+    // The credential holds on to the keytab it got acquired from.
+    if (keytabGeneration != AcceptorKeytab::generation()) {
+      keytabGeneration = AcceptorKeytab::generation();
+
+      Try<gss_cred_id_t> acquired =
+        acceptorCredential(name, !options.memoryReplayCache);
+      if (acquired.isError()) {
+        LOG(WARNING) << "Keeping the previous acceptor credential: "
+                     << acquired.error();
+      } else {
+        OM_uint32 ignored;
+        gss_release_cred(&ignored, &credential);
+        credential = acquired.get();
+      }
+    }
+
+    gss_buffer_desc input;
+    input.value = const_cast<char*>(data.data());
+    input.length = data.size();
+
+    gss_buffer_desc output = GSS_C_EMPTY_BUFFER;
+    gss_name_t client = GSS_C_NO_NAME;
+    OM_uint32 minor;
+
+    OM_uint32 major = gss_accept_sec_context(
+        &minor,
+        &session->context,
+        credential,
+        &input,
+        GSS_C_NO_CHANNEL_BINDINGS,
+        &client,
+        NULL,       // Mechanism, always Kerberos here.
+        &output,
+        NULL,       // Flags.
+        NULL,       // Lifetime of the context.
+        NULL);      // Delegated credentials.
+
+    if (output.length > 0) {
+      AuthenticationStepMessage message;
+      message.set_data(output.value, output.length);
+      send(session->pid, message);
+    }
+
+    OM_uint32 ignored;
+    gss_release_buffer(&ignored, &output);
+
+    if (GSS_ERROR(major)) {
+      LOG(WARNING) << "Authentication failure for " << session->pid << ": "
+                   << status(major, minor);
+      send(session->pid, AuthenticationFailedMessage());
+      session->promise.set(Option<string>::none());
+      sessions.erase(session->pid);
+      return;
+    }
+
+    if (major == GSS_S_CONTINUE_NEEDED) {
+      LOG(INFO) << "Authentication requires more steps";
+      return;
+    }
+
+    gss_buffer_desc name = GSS_C_EMPTY_BUFFER;
+    major = gss_display_name(&minor, client, &name, NULL);
+    gss_release_name(&ignored, &client);
+
+    if (GSS_ERROR(major)) {
+      const string message =
+        "Failed to retrieve principal after successful authentication: " +
+        status(major, minor);
+      LOG(ERROR) << message;
+      error(session, message);
+      return;
+    }
+
+    const string principal(static_cast<const char*>(name.value), name.length);
+    gss_release_buffer(&ignored, &name);
+
+    if (!realm.empty() && !strings::endsWith(principal, "@" + realm)) {
+      LOG(WARNING) << "Authentication failure for " << session->pid
+                   << ": Principal '" << principal << "' is not of realm '"
+                   << realm << "'";
+      send(session->pid, AuthenticationFailedMessage());
+      session->promise.set(Option<string>::none());
+      sessions.erase(session->pid);
+      return;
+    }
+
+    if (replays.get() != NULL && !replays->insert(principal, session->token)) {
+      LOG(WARNING) << "Rejecting replayed authenticator of '" << principal
+                   << "' from " << session->pid;
+      send(session->pid, AuthenticationFailedMessage());
+      session->promise.set(Option<string>::none());
+      sessions.erase(session->pid);
+      return;
+    }
+
+    LOG(INFO) << "Authentication success for " << session->pid;
+    send(session->pid, AuthenticationCompletedMessage());
+    session->promise.set(Option<string>(principal));
+    sessions.erase(session->pid);
+  }
+
+  // Fails and removes 'session' after reporting 'message' to the
+  // authenticatee.
+  void error(shared_ptr<Session> session, const string& message_)
+  {
+    AuthenticationErrorMessage message;
+    message.set_error(message_);
+    send(session->pid, message);
+    session->promise.fail(message_);
+    sessions.erase(session->pid);
+  }
+
+  const string realm;
+
+  // Acceptor credential for 'name', i.e., 'service@server', acquired
+  // from the keytab of 'keytabGeneration'.
+  gss_name_t name;
+  gss_cred_id_t credential;
+  uint64_t keytabGeneration;
+
+  const GSSAPIAuthenticator::Options options;
+
+  // NULL if Kerberos does the replay detection.
+  Owned<ReplayCache> replays;
+
+  uint64_t sessionId;
+
+  hashmap<UPID, shared_ptr<Session>> sessions;
+
+  // Starts sent by authenticatees ahead of their request.
+  EarlyStarts earlyStarts;
+};
+
+
+NativeGSSAPIAuthenticator::NativeGSSAPIAuthenticator()
+  : process(NULL) {}
+
+
+NativeGSSAPIAuthenticator::~NativeGSSAPIAuthenticator()
+{
+  if (process != NULL) {
+    terminate(process);
+    wait(process);
+    delete process;
+  }
+}
+
+
+Try<Nothing> NativeGSSAPIAuthenticator::initialize(
+  const Option<Credentials>& credentials)
+{
+  if (process != NULL) {
+    return Error("Authenticator initialized already");
+  }
+
+  if (options.preloadKeytab) {
+    Try<Nothing> preloaded =
+      AcceptorKeytab::preload(options.keytab, options.keytabReloadInterval);
+    if (preloaded.isError()) {
+      return Error(preloaded.error());
+    }
+  }
+
+  Try<string> hostname = net::hostname();
+  if (hostname.isError()) {
+    return Error("Failed to resolve hostname: " + hostname.error());
+  }
+
+  Try<gss_name_t> name = serviceName(
+      service.empty() ? "mesos" : service,
+      serverPrefix + hostname.get());
+
+  if (name.isError()) {
+    return Error(name.error());
+  }
+
+  // Acquire the credential up front, failing early on a missing or
+  // unreadable keytab rather than with the first authentication.
+  Try<gss_cred_id_t> credential =
+    acceptorCredential(name.get(), !options.memoryReplayCache);
+  if (credential.isError()) {
+    OM_uint32 ignored;
+    gss_name_t name_ = name.get();
+    gss_release_name(&ignored, &name_);
+    return Error(credential.error());
+  }
+
+  process = new NativeGSSAPIAuthenticatorProcess(
+      realm, name.get(), credential.get(), options);
+
+  spawn(process);
+
+  return Nothing();
+}
+
+
+void NativeGSSAPIAuthenticator::prepare(
+    const string& service_,
+    const string& serverPrefix_,
+    const string& realm_,
+    const GSSAPIAuthenticator::Options& options_)
+{
+  service = service_;
+  serverPrefix = serverPrefix_;
+  realm = realm_;
+  options = options_;
+}
+
+
+Future<Option<string>> NativeGSSAPIAuthenticator::authenticate(
+    const UPID& pid)
+{
+  if (process == NULL) {
+    return Failure("Authenticator not initialized");
+  }
+
+  return dispatch(
+      process, &NativeGSSAPIAuthenticatorProcess::authenticate, pid);
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,82 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_NATIVE_AUTHENTICATOR_HPP__
+#define __AUTHENTICATION_GSSAPI_NATIVE_AUTHENTICATOR_HPP__
+
+#include <string>
+
+#include <mesos/mesos.hpp>
+
+#include <mesos/module/authenticator.hpp>
+
+#include <process/future.hpp>
+#include <process/process.hpp>
+
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include "authenticator.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Forward declarations.
+class NativeGSSAPIAuthenticatorProcess;
+
+// Kerberos authenticator calling into GSS-API directly instead of
+// going through the SASL GSSAPI mechanism, which adds a security
+// layer negotiation of two more messages after mutual authentication.
+// The authenticatee sends its AP-REQ as the start, the AP-REP comes
+// back as a single step right ahead of the completion.
+//
+// Takes the options of the SASL flavor; worker threads, pending
+// sessions and the hostname refresh do not apply as there is only a
+// single GSS-API call per authentication. The realm, if given,
+// restricts the principals getting authenticated.
+class NativeGSSAPIAuthenticator : public Authenticator
+{
+public:
+  NativeGSSAPIAuthenticator();
+
+  virtual ~NativeGSSAPIAuthenticator();
+
+  void prepare(const std::string& service_,
+               const std::string& serverPrefix_,
+               const std::string& realm_,
+               const GSSAPIAuthenticator::Options& options_);
+
+  virtual Try<Nothing> initialize(const Option<Credentials>& credentials);
+
+  virtual process::Future<Option<std::string>> authenticate(
+      const process::UPID& pid);
+
+private:
+  NativeGSSAPIAuthenticatorProcess* process;
+
+  std::string service;
+  std::string serverPrefix;
+  std::string realm;
+  GSSAPIAuthenticator::Options options;
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __AUTHENTICATION_GSSAPI_NATIVE_AUTHENTICATOR_HPP__
@@ -0,0 +1,228 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <stdint.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include <openssl/sha.h>
+
+#include <process/clock.hpp>
+
+#include <stout/check.hpp>
+#include <stout/none.hpp>
+#include <stout/option.hpp>
+
+#include "replay_cache.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using process::Clock;
+using process::Time;
+
+using std::string;
+
+// DER tags of the elements on the way to the authenticator of an
+// AP-REQ, see RFC 2743 section 3.1 and RFC 4120 section 5.5.1.
+static const unsigned char GSS_TOKEN = 0x60;     // [APPLICATION 0]
+static const unsigned char OID = 0x06;
+static const unsigned char AP_REQ = 0x6e;        // [APPLICATION 14]
+static const unsigned char SEQUENCE = 0x30;
+static const unsigned char AUTHENTICATOR = 0xa4; // [4]
+static const unsigned char CIPHER = 0xa2;        // [2]
+static const unsigned char OCTET_STRING = 0x04;
+
+// Token identifier of a Kerberos AP-REQ, RFC 1964 section 1.1.1.
+static const char KRB_AP_REQ[] = {0x01, 0x00};
+
+
+// Reads the header of the DER element at '*offset' of 'data', which
+// must be tagged 'tag'. Leaves '*offset' at its content and returns
+// the length of the content, none if malformed.
+static Option<size_t> header(
+    const string& data,
+    size_t* offset,
+    unsigned char tag)
+{
+  if (data.size() - *offset < 2 ||
+      static_cast<unsigned char>(data[*offset]) != tag) {
+    return None();
+  }
+
+  size_t length = static_cast<unsigned char>(data[*offset + 1]);
+  *offset += 2;
+
+  if (length & 0x80) {
+    const size_t bytes = length & 0x7f;
+    if (bytes == 0 || bytes > sizeof(uint32_t) ||
+        data.size() - *offset < bytes) {
+      return None();
+    }
+
+    length = 0;
+    for (size_t i = 0; i < bytes; i++) {
+      length = (length << 8) | static_cast<unsigned char>(data[(*offset)++]);
+    }
+  }
+
+  if (data.size() - *offset < length) {
+    return None();
+  }
+
+  return length;
+}
+
+
+// Returns the ciphertext of the authenticator of the AP-REQ in
+// 'token', with or without the GSS-API framing, none if malformed.
+static Option<string> authenticator(const string& token)
+{
+  size_t offset = 0;
+
+  if (!token.empty() && static_cast<unsigned char>(token[0]) == GSS_TOKEN) {
+    Option<size_t> length = header(token, &offset, GSS_TOKEN);
+    if (length.isNone()) {
+      return None();
+    }
+
+    length = header(token, &offset, OID);
+    if (length.isNone()) {
+      return None();
+    }
+    offset += length.get();
+
+    if (token.compare(offset, sizeof(KRB_AP_REQ),
+                      KRB_AP_REQ, sizeof(KRB_AP_REQ)) != 0) {
+      return None();
+    }
+    offset += sizeof(KRB_AP_REQ);
+  }
+
+  if (header(token, &offset, AP_REQ).isNone()) {
+    return None();
+  }
+
+  Option<size_t> length = header(token, &offset, SEQUENCE);
+  if (length.isNone()) {
+    return None();
+  }
+
+  // Skip pvno, msg-type, ap-options and the ticket.
+  const size_t end = offset + length.get();
+  while (offset < end &&
+         static_cast<unsigned char>(token[offset]) != AUTHENTICATOR) {
+    Option<size_t> field =
+      header(token, &offset, static_cast<unsigned char>(token[offset]));
+    if (field.isNone()) {
+      return None();
+    }
+    offset += field.get();
+  }
+
+  if (header(token, &offset, AUTHENTICATOR).isNone()) {
+    return None();
+  }
+
+  length = header(token, &offset, SEQUENCE);
+  if (length.isNone()) {
+    return None();
+  }
+
+  // Skip etype and kvno of the EncryptedData.
+  const size_t data = offset + length.get();
+  while (offset < data &&
+         static_cast<unsigned char>(token[offset]) != CIPHER) {
+    Option<size_t> field =
+      header(token, &offset, static_cast<unsigned char>(token[offset]));
+    if (field.isNone()) {
+      return None();
+    }
+    offset += field.get();
+  }
+
+  if (header(token, &offset, CIPHER).isNone()) {
+    return None();
+  }
+
+  length = header(token, &offset, OCTET_STRING);
+  if (length.isNone()) {
+    return None();
+  }
+
+  return token.substr(offset, length.get());
+}
+
+
+ReplayCache::ReplayCache(size_t shards_, const Duration& clockSkew)
+  : ttl(clockSkew * 2)
+{
+  CHECK_GT(shards_, 0u);
+
+  for (size_t i = 0; i < shards_; i++) {
+    shards.push_back(std::unique_ptr<Shard>(new Shard()));
+  }
+}
+
+
+bool ReplayCache::insert(const string& principal, const string& token)
+{
+  std::hash<string> hash;
+
+  Shard* shard = shards[hash(principal) % shards.size()].get();
+
+  // Like the replay cache of Kerberos, identify the AP-REQ by its
+  // authenticator. Unlike the rest of the token, e.g., the ap-options
+  // or the framing, it cannot be altered without failing decryption,
+  // so a replay cannot pass for a different AP-REQ.
+  const Option<string> cipher = authenticator(token);
+  if (cipher.isNone()) {
+    return false;
+  }
+
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const unsigned char*>(cipher.get().data()),
+         cipher.get().size(),
+         digest);
+
+  const string entry =
+    principal + '\0' + string(reinterpret_cast<char*>(digest), sizeof(digest));
+
+  const Time now = Clock::now();
+
+  std::lock_guard<std::mutex> lock(shard->mutex);
+
+  while (!shard->expiries.empty() && shard->expiries.front().first <= now) {
+    shard->entries.erase(shard->expiries.front().second);
+    shard->expiries.pop_front();
+  }
+
+  if (!shard->entries.insert(entry).second) {
+    return false;
+  }
+
+  shard->expiries.push_back(std::make_pair(now + ttl, entry));
+
+  return true;
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,86 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_REPLAY_CACHE_HPP__
+#define __AUTHENTICATION_GSSAPI_REPLAY_CACHE_HPP__
+
+#include <stddef.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <process/clock.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/hashset.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// How far the clocks of authenticatees may be off, as configured for
+// the KDC realm ('clockskew' in krb5.conf).
+const Duration DEFAULT_CLOCK_SKEW = Minutes(5);
+
+const size_t DEFAULT_REPLAY_CACHE_SHARDS = 16;
+
+
+// In-memory replacement for the file backed replay cache of Kerberos,
+// which does synchronous I/O under a lock for every accepted AP-REQ.
+// Remembers the SHA-256 digests of the authenticators of the AP-REQs
+// accepted within twice the clock skew, the longest an authenticator
+// timestamp stays acceptable. Sharded by client principal so that
+// handshakes running on the worker pool rarely contend. Thread safe.
+//
+// Only takes effect with acceptor credentials which skip the replay
+// cache of Kerberos, see 'acceptorCredential'.
+class ReplayCache
+{
+public:
+  ReplayCache(size_t shards, const Duration& clockSkew);
+
+  // Records the authenticator of the AP-REQ 'token' of 'principal',
+  // the token being the first one of the GSS-API handshake. Returns
+  // false if it got recorded before, i.e., if it is getting replayed,
+  // as well as if the token holds no AP-REQ.
+  bool insert(const std::string& principal, const std::string& token);
+
+private:
+  struct Shard
+  {
+    std::mutex mutex;
+    hashset<std::string> entries;
+
+    // Entries in the order they expire.
+    std::deque<std::pair<process::Time, std::string>> expiries;
+  };
+
+  const Duration ttl;
+
+  std::vector<std::unique_ptr<Shard>> shards;
+};
+
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_REPLAY_CACHE_HPP__
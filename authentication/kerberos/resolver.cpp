@@ -0,0 +1,185 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <string>
+
+#include <process/async.hpp>
+#include <process/clock.hpp>
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/once.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "resolver.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+using namespace process;
+
+using std::string;
+
+class ResolverProcess : public Process<ResolverProcess>
+{
+public:
+  explicit ResolverProcess(const Resolver::Lookup& _lookup)
+    : ProcessBase(ID::generate("gssapi_resolver")),
+      lookup(_lookup) {}
+
+  virtual ~ResolverProcess() {}
+
+  virtual void finalize()
+  {
+    foreachvalue (const Owned<Promise<string>>& promise, pending) {
+      promise->discard();
+    }
+  }
+
+  Future<string> hostname(
+      const net::IP& ip,
+      const Duration& ttl,
+      const Duration& negativeTtl)
+  {
+    const string key = stringify(ip);
+
+    Option<Entry> entry = cache.get(key);
+    if (entry.isSome() && Clock::now() < entry.get().expiry) {
+      if (entry.get().hostname.isError()) {
+        return Failure(entry.get().hostname.error());
+      }
+      return entry.get().hostname.get();
+    }
+
+    if (!pending.contains(key)) {
+      VLOG(1) << "Resolving hostname of " << key;
+
+      pending.put(key, Owned<Promise<string>>(new Promise<string>()));
+
+      async(lookup, ip)
+        .onAny(defer(
+            self(),
+            &Self::resolved,
+            key,
+            ttl,
+            negativeTtl,
+            lambda::_1));
+    }
+
+    return pending[key]->future();
+  }
+
+private:
+  struct Entry
+  {
+    Entry(const Try<string>& _hostname, const Time& _expiry)
+      : hostname(_hostname), expiry(_expiry) {}
+
+    Try<string> hostname;
+    Time expiry;
+  };
+
+  void resolved(
+      const string& key,
+      const Duration& ttl,
+      const Duration& negativeTtl,
+      const Future<Try<string>>& future)
+  {
+    Try<string> hostname = Error("Lookup discarded");
+    if (future.isReady()) {
+      hostname = future.get();
+    } else if (future.isFailed()) {
+      hostname = Error(future.failure());
+    }
+
+    const Duration expiry = hostname.isSome() ? ttl : negativeTtl;
+
+    cache.put(key, Entry(hostname, Clock::now() + expiry));
+
+    Owned<Promise<string>> promise = pending[key];
+    pending.erase(key);
+
+    if (hostname.isError()) {
+      LOG(WARNING) << "Failed to resolve hostname of " << key << ": "
+                   << hostname.error();
+      promise->fail(hostname.error());
+    } else {
+      promise->set(hostname.get());
+    }
+  }
+
+  const Resolver::Lookup lookup;
+
+  // Most recent lookup result for each address.
+  hashmap<string, Entry> cache;
+
+  // Lookups in flight.
+  hashmap<string, Owned<Promise<string>>> pending;
+};
+
+
+Resolver::Resolver(const Lookup& lookup)
+{
+  process = new ResolverProcess(lookup);
+  spawn(process);
+}
+
+
+Resolver::~Resolver()
+{
+  terminate(process);
+  wait(process);
+  delete process;
+}
+
+
+Future<string> Resolver::resolve(
+    const net::IP& ip,
+    const Duration& ttl,
+    const Duration& negativeTtl)
+{
+  return dispatch(process, &ResolverProcess::hostname, ip, ttl, negativeTtl);
+}
+
+
+Future<string> Resolver::hostname(
+    const net::IP& ip,
+    const Duration& ttl,
+    const Duration& negativeTtl)
+{
+  static Once* initialize = new Once();
+  static Resolver* resolver = NULL;
+
+  if (!initialize->once()) {
+    resolver = new Resolver(&net::getHostname);
+    initialize->done();
+  }
+
+  return resolver->resolve(ip, ttl, negativeTtl);
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,75 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_RESOLVER_HPP__
+#define __AUTHENTICATION_GSSAPI_RESOLVER_HPP__
+
+#include <string>
+
+#include <process/future.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/lambda.hpp>
+#include <stout/net.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// Process wide cache of reverse DNS lookups. Lookups run off the
+// libprocess worker threads and concurrent requests for the same
+// address share a single lookup. Resolved hostnames are cached for
+// 'ttl', failed lookups for 'negativeTtl', so that retries during a
+// DNS outage do not each wait for the resolver to time out. The TTLs
+// of the request which triggered a lookup apply to its result.
+class ResolverProcess;
+
+
+class Resolver
+{
+public:
+  // Blocking lookup of the hostname of an address.
+  typedef lambda::function<Try<std::string>(const net::IP&)> Lookup;
+
+  explicit Resolver(const Lookup& lookup);
+  ~Resolver();
+
+  process::Future<std::string> resolve(
+      const net::IP& ip,
+      const Duration& ttl,
+      const Duration& negativeTtl);
+
+  // Resolves through the process wide cache, looking up hostnames
+  // with 'net::getHostname'.
+  static process::Future<std::string> hostname(
+      const net::IP& ip,
+      const Duration& ttl,
+      const Duration& negativeTtl);
+
+private:
+  Resolver(const Resolver&);
+  Resolver& operator=(const Resolver&);
+
+  ResolverProcess* process;
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_RESOLVER_HPP__
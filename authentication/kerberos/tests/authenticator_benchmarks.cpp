@@ -0,0 +1,390 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+// Benchmarks of the GSSAPI authenticator sessions, run through 'make
+// bench'. No KDC is involved: simulated agents answer the offered
+// mechanisms with a bogus GSSAPI token, which ends their session after
+// a single SASL server start. That leaves the cost of the session
+// handling itself, which is what these benchmarks are about. Prints
+// one JSON object per run.
+//
+// The sessions benchmark runs up to 'max sessions' sessions at once.
+// The retries benchmark has agents lose some of the offers of the
+// mechanisms and retry, with and without 'preemptStaleSessions', and
+// reports the time until each agent's session got its start answered.
+//
+// Usage: kerberos-authenticator-benchmarks [max sessions]
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <mesos/mesos.hpp>
+
+#include <process/defer.hpp>
+#include <process/delay.hpp>
+#include <process/dispatch.hpp>
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <glog/logging.h>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/lambda.hpp>
+#include <stout/none.hpp>
+#include <stout/nothing.hpp>
+#include <stout/numify.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/kerberos/authenticator.hpp"
+
+using namespace mesos::internal::gssapi;
+using namespace process;
+
+using mesos::internal::AuthenticationMechanismsMessage;
+using mesos::internal::AuthenticationStartMessage;
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+// Agents of the retries benchmark, the probability that an offer of
+// the mechanisms gets lost, how long an agent waits for its session
+// to end before retrying and the deadline of the sessions.
+static const size_t RETRYING_AGENTS = 1000;
+static const double LOSS = 0.1;
+static const Duration RETRY_INTERVAL = Milliseconds(200);
+static const Duration HANDSHAKE_TIMEOUT = Seconds(2);
+
+
+// Answers the mechanisms offered by the authenticator with a start
+// carrying a token no acceptor will take.
+class AgentProcess : public ProtobufProcess<AgentProcess>
+{
+public:
+  AgentProcess() : ProcessBase(ID::generate("agent")) {}
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticationMechanismsMessage>(&AgentProcess::mechanisms);
+  }
+
+  void mechanisms(
+      const UPID& from,
+      const AuthenticationMechanismsMessage& message)
+  {
+    AuthenticationStartMessage start;
+    start.set_mechanism("GSSAPI");
+    start.set_data("bogus");
+    send(from, start);
+  }
+};
+
+
+// Like 'AgentProcess', but loses every offer of the mechanisms with
+// probability 'LOSS'. Asks for a new session if its current one did
+// not end within 'RETRY_INTERVAL', like an authenticatee timing out.
+class RetryingAgentProcess : public ProtobufProcess<RetryingAgentProcess>
+{
+public:
+  RetryingAgentProcess(GSSAPIAuthenticator* _authenticator, unsigned seed)
+    : ProcessBase(ID::generate("agent")),
+      authenticator(_authenticator),
+      random(seed),
+      attempts(0),
+      started(false) {}
+
+  // Completes with the milliseconds it took until a session of this
+  // agent got its start answered.
+  Future<double> run()
+  {
+    begin = SteadyClock::now();
+    retry(attempts);
+    return promise.future();
+  }
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticationMechanismsMessage>(
+        &RetryingAgentProcess::mechanisms);
+  }
+
+  void mechanisms(
+      const UPID& from,
+      const AuthenticationMechanismsMessage& message)
+  {
+    if (std::uniform_real_distribution<double>(0, 1)(random) < LOSS) {
+      return;
+    }
+
+    started = true;
+
+    AuthenticationStartMessage start;
+    start.set_mechanism("GSSAPI");
+    start.set_data("bogus");
+    send(from, start);
+  }
+
+  // Starts a new attempt unless 'attempt' got superseded or the agent
+  // is done.
+  void retry(size_t attempt)
+  {
+    if (attempt != attempts || !promise.future().isPending()) {
+      return;
+    }
+
+    attempts++;
+    started = false;
+
+    authenticator->authenticate(self())
+      .onAny(defer(self(), &Self::finished, attempts, lambda::_1));
+
+    delay(RETRY_INTERVAL, self(), &Self::retry, attempts);
+  }
+
+  // Attempts which got rejected for a session still being active, or
+  // whose offer got lost, did not start.
+  void finished(size_t attempt, const Future<Option<string>>& future)
+  {
+    if (attempt == attempts && started) {
+      promise.set(std::chrono::duration<double, std::milli>(
+          SteadyClock::now() - begin).count());
+    }
+  }
+
+private:
+  GSSAPIAuthenticator* authenticator;
+  std::minstd_rand random;
+  size_t attempts;
+  bool started;
+  SteadyClock::time_point begin;
+  Promise<double> promise;
+};
+
+
+// Does nothing, stands in for the process each session used to run
+// in.
+class SessionProcess : public Process<SessionProcess>
+{
+public:
+  SessionProcess() : ProcessBase(ID::generate("session")) {}
+};
+
+
+static double percentile(const vector<double>& sorted, double percent)
+{
+  return sorted[std::min(
+      sorted.size() - 1,
+      static_cast<size_t>(sorted.size() * percent / 100))];
+}
+
+
+static double milliseconds(const SteadyClock::time_point& start)
+{
+  return std::chrono::duration<double, std::milli>(
+      SteadyClock::now() - start).count();
+}
+
+
+static Owned<GSSAPIAuthenticator> create(
+    const GSSAPIAuthenticator::Options& options)
+{
+  Owned<GSSAPIAuthenticator> authenticator(new GSSAPIAuthenticator());
+  authenticator->prepare("mesos", "", "", options);
+
+  Try<Nothing> initialize = authenticator->initialize(None());
+  CHECK(initialize.isSome()) << initialize.error();
+
+  return authenticator;
+}
+
+
+// Time it takes to spawn 'sessions' processes and to terminate and
+// wait for each of them, the overhead a process per session adds.
+static double processPerSession(size_t sessions)
+{
+  const SteadyClock::time_point start = SteadyClock::now();
+
+  vector<Owned<SessionProcess>> processes;
+  for (size_t i = 0; i < sessions; i++) {
+    processes.push_back(Owned<SessionProcess>(new SessionProcess()));
+    spawn(processes.back().get());
+  }
+
+  foreach (const Owned<SessionProcess>& process, processes) {
+    terminate(process.get(), false);
+    wait(process.get());
+  }
+
+  return milliseconds(start);
+}
+
+
+// Runs 'sessions' sessions at once through a single authenticator.
+static void benchmarkSessions(size_t sessions)
+{
+  Owned<GSSAPIAuthenticator> authenticator =
+    create(GSSAPIAuthenticator::Options());
+
+  vector<Owned<AgentProcess>> agents;
+  for (size_t i = 0; i < sessions; i++) {
+    agents.push_back(Owned<AgentProcess>(new AgentProcess()));
+    spawn(agents.back().get());
+  }
+
+  // Completion time of each session, written by its own callback
+  // only, which then signals that it is done with it.
+  vector<double> latencies(sessions);
+  vector<Future<Nothing>> completed;
+
+  const SteadyClock::time_point start = SteadyClock::now();
+
+  for (size_t i = 0; i < sessions; i++) {
+    double* latency = &latencies[i];
+    Owned<Promise<Nothing>> promise(new Promise<Nothing>());
+    completed.push_back(promise->future());
+
+    authenticator->authenticate(agents[i]->self())
+      .onAny([=]() {
+        *latency = milliseconds(start);
+        promise->set(Nothing());
+      });
+  }
+
+  foreach (const Future<Nothing>& future, completed) {
+    future.await();
+  }
+
+  const double total = milliseconds(start);
+
+  std::sort(latencies.begin(), latencies.end());
+
+  JSON::Object result;
+  result.values["benchmark"] = "gssapi_sessions";
+  result.values["sessions"] = sessions;
+  result.values["sessions_per_second"] = sessions / (total / 1000);
+  result.values["total_ms"] = total;
+  result.values["p50_ms"] = percentile(latencies, 50);
+  result.values["p99_ms"] = percentile(latencies, 99);
+  result.values["process_per_session_ms"] = processPerSession(sessions);
+
+  cout << stringify(result) << endl;
+
+  authenticator.reset();
+
+  foreach (const Owned<AgentProcess>& agent, agents) {
+    terminate(agent.get());
+    wait(agent.get());
+  }
+}
+
+
+// Has 'agents' agents which lose some of their messages authenticate
+// at once.
+static void benchmarkRetries(size_t agents, bool preempt)
+{
+  GSSAPIAuthenticator::Options options;
+  options.handshakeTimeout = HANDSHAKE_TIMEOUT;
+  options.preemptStaleSessions = preempt;
+
+  Owned<GSSAPIAuthenticator> authenticator = create(options);
+
+  vector<Owned<RetryingAgentProcess>> processes;
+  for (size_t i = 0; i < agents; i++) {
+    processes.push_back(Owned<RetryingAgentProcess>(
+        new RetryingAgentProcess(authenticator.get(), i + 1)));
+    spawn(processes.back().get());
+  }
+
+  const SteadyClock::time_point start = SteadyClock::now();
+
+  vector<Future<double>> futures;
+  foreach (const Owned<RetryingAgentProcess>& process, processes) {
+    futures.push_back(dispatch(process.get(), &RetryingAgentProcess::run));
+  }
+
+  vector<double> latencies;
+  foreach (const Future<double>& future, futures) {
+    future.await();
+    CHECK(future.isReady());
+    latencies.push_back(future.get());
+  }
+
+  const double total = milliseconds(start);
+
+  std::sort(latencies.begin(), latencies.end());
+
+  JSON::Object result;
+  result.values["benchmark"] = "gssapi_retries";
+  result.values["agents"] = agents;
+  result.values["preempt_stale_sessions"] = preempt;
+  result.values["loss"] = LOSS;
+  result.values["total_ms"] = total;
+  result.values["p50_ms"] = percentile(latencies, 50);
+  result.values["p90_ms"] = percentile(latencies, 90);
+  result.values["p99_ms"] = percentile(latencies, 99);
+  result.values["max_ms"] = latencies.back();
+
+  cout << stringify(result) << endl;
+
+  authenticator.reset();
+
+  foreach (const Owned<RetryingAgentProcess>& process, processes) {
+    terminate(process.get());
+    wait(process.get());
+  }
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  size_t max = 10000;
+
+  if (argc > 1) {
+    Try<size_t> sessions = numify<size_t>(argv[1]);
+    CHECK(sessions.isSome()) << "Invalid max sessions: " << argv[1];
+    max = sessions.get();
+  }
+
+  for (size_t sessions = 10; sessions <= max; sessions *= 10) {
+    benchmarkSessions(sessions);
+  }
+
+  benchmarkRetries(std::min(max, RETRYING_AGENTS), false);
+  benchmarkRetries(std::min(max, RETRYING_AGENTS), true);
+
+  return EXIT_SUCCESS;
+}
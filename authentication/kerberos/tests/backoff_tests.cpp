@@ -0,0 +1,184 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+// Tests of the jittered Backoff of the authenticatees, run through
+// 'make check'. Draws are random, the checks hold for every draw or
+// with a margin which sampling does not come near. Exits with a
+// failure as soon as a check does not hold.
+//
+// The simulation has 'AGENTS' agents fail at once, as on a failover of
+// the master, and retry 'ROUNDS' times. It prints the share of the
+// agents which retried within the busiest 'WINDOW' of each round.
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/stringify.hpp>
+
+#include "authentication/kerberos/backoff.hpp"
+
+using namespace mesos::internal::gssapi;
+
+using std::cout;
+using std::endl;
+using std::map;
+using std::vector;
+
+static const Duration MIN = Milliseconds(100);
+static const Duration MAX = Seconds(10);
+
+static const size_t DRAWS = 100000;
+
+static const size_t AGENTS = 10000;
+static const size_t ROUNDS = 8;
+static const Duration WINDOW = Milliseconds(100);
+
+
+// Every delay lies between 'MIN' and the lesser of 'MAX' and three
+// times the previous one.
+static void testBounds()
+{
+  Backoff backoff(MIN, MAX);
+
+  Duration previous = MIN;
+  for (size_t i = 0; i < DRAWS; i++) {
+    const Duration delay = backoff.next();
+
+    CHECK_GE(delay, MIN);
+    CHECK_LE(delay, MAX);
+    CHECK_LE(delay, std::max(MIN, previous * 3));
+
+    previous = delay;
+  }
+}
+
+
+// Delays grow up to the cap rather than hovering around 'MIN', and
+// come down again.
+static void testRange()
+{
+  Backoff backoff(MIN, MAX);
+
+  Duration shortest = MAX;
+  Duration longest = MIN;
+  for (size_t i = 0; i < DRAWS; i++) {
+    const Duration delay = backoff.next();
+    shortest = std::min(shortest, delay);
+    longest = std::max(longest, delay);
+  }
+
+  CHECK_LT(shortest, MIN * 2);
+  CHECK_GT(longest, MAX / 2);
+}
+
+
+// A cap below the minimum leaves the minimum, as do equal bounds.
+static void testDegenerateBounds()
+{
+  Backoff inverted(MAX, MIN);
+  Backoff fixed(MIN, MIN);
+
+  for (size_t i = 0; i < 100; i++) {
+    CHECK_EQ(MAX, inverted.next());
+    CHECK_EQ(MIN, fixed.next());
+  }
+}
+
+
+// Agents which failed together spread out over the rounds, where a
+// fixed delay would bring all of them back within the same window.
+static void testSimulation()
+{
+  // Constructed one by one, copies would draw the same delays.
+  vector<Backoff> backoffs;
+  backoffs.reserve(AGENTS);
+  for (size_t i = 0; i < AGENTS; i++) {
+    backoffs.emplace_back(MIN, MAX);
+  }
+
+  vector<Duration> times(AGENTS, Duration::zero());
+
+  vector<double> peaks;
+  double previous = 1;
+
+  for (size_t round = 1; round <= ROUNDS; round++) {
+    map<int64_t, size_t> windows;
+    for (size_t i = 0; i < AGENTS; i++) {
+      times[i] += backoffs[i].next();
+      windows[times[i].ns() / WINDOW.ns()]++;
+    }
+
+    size_t peak = 0;
+    foreachvalue (size_t agents, windows) {
+      peak = std::max(peak, agents);
+    }
+
+    const double share = static_cast<double>(peak) / AGENTS;
+
+    // The first round spans two windows, the following ones spread
+    // the agents out further until the delays approach the cap.
+    // Sampling deviates by about a percent.
+    if (round == 1) {
+      CHECK_LT(share, 0.55);
+    } else if (round <= 5) {
+      CHECK_LT(share, previous * 0.9) << "Round " << round;
+    } else {
+      CHECK_LE(share, peaks[4]) << "Round " << round;
+    }
+
+    peaks.push_back(share);
+    previous = share;
+  }
+
+  // By the fifth round a master sees a tenth of the agents at a time
+  // at most.
+  CHECK_LT(peaks[4], 0.1);
+
+  JSON::Array shares;
+  foreach (double share, peaks) {
+    shares.values.push_back(share);
+  }
+
+  JSON::Object result;
+  result.values["simulation"] = "backoff";
+  result.values["agents"] = AGENTS;
+  result.values["window_ms"] = WINDOW.ms();
+  result.values["peak_share_by_round"] = shares;
+
+  cout << stringify(result) << endl;
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  testBounds();
+  testRange();
+  testDegenerateBounds();
+  testSimulation();
+
+  return EXIT_SUCCESS;
+}
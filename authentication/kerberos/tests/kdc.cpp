@@ -0,0 +1,147 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <glog/logging.h>
+
+#include <stout/check.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include "authentication/kerberos/tests/kdc.hpp"
+
+using std::string;
+
+const char KDC::REALM[] = "MESOS.TEST";
+const char KDC::AGENT[] = "agent";
+
+
+KDC::KDC(const string& _directory, const string& host)
+  : directory(_directory), pid(path::join(directory, "krb5kdc.pid"))
+{
+  const string port = stringify(freePort());
+
+  CHECK_SOME(os::write(
+      path::join(directory, "krb5.conf"),
+      "[libdefaults]\n"
+      "  default_realm = " + string(REALM) + "\n"
+      "  dns_lookup_kdc = false\n"
+      "  dns_lookup_realm = false\n"
+      "  dns_canonicalize_hostname = false\n"
+      "  rdns = false\n"
+      // The authenticator names itself after the local hostname,
+      // the authenticatee after the reverse lookup of its address.
+      "  ignore_acceptor_hostname = true\n"
+      "[realms]\n"
+      "  " + string(REALM) + " = {\n"
+      "    kdc = 127.0.0.1:" + port + "\n"
+      "  }\n"
+      "[domain_realm]\n"
+      "  " + host + " = " + string(REALM) + "\n"));
+
+  CHECK_SOME(os::write(
+      path::join(directory, "kdc.conf"),
+      "[kdcdefaults]\n"
+      "  kdc_ports = " + port + "\n"
+      "  kdc_tcp_ports = " + port + "\n"
+      "[realms]\n"
+      "  " + string(REALM) + " = {\n"
+      "    database_name = " + path::join(directory, "principal") + "\n"
+      "    key_stash_file = " + path::join(directory, "stash") + "\n"
+      "    acl_file = " + path::join(directory, "kadm5.acl") + "\n"
+      "  }\n"
+      "[logging]\n"
+      "  kdc = FILE:" + path::join(directory, "krb5kdc.log") + "\n"));
+
+  os::setenv("KRB5_CONFIG", path::join(directory, "krb5.conf"));
+  os::setenv("KRB5_KDC_PROFILE", path::join(directory, "kdc.conf"));
+
+  run("kdb5_util create -s -r " + string(REALM) + " -P master");
+
+  addPrincipal("mesos/" + host, "acceptor.keytab");
+  addPrincipal(AGENT, "client.keytab");
+
+  run("krb5kdc -P " + pid);
+
+  // The authenticator reads the service key from the default keytab,
+  // the authenticatee gets its tickets with the client keytab.
+  os::setenv("KRB5_KTNAME",
+             "FILE:" + path::join(directory, "acceptor.keytab"));
+  os::setenv("KRB5_CLIENT_KTNAME",
+             "FILE:" + path::join(directory, "client.keytab"));
+  os::setenv("KRB5CCNAME", "FILE:" + path::join(directory, "ccache"));
+  os::setenv("KRB5RCACHEDIR", directory);
+}
+
+
+KDC::~KDC()
+{
+  os::system("kill $(cat " + pid + ") 2>/dev/null");
+}
+
+
+bool KDC::installed()
+{
+  os::setenv("PATH", os::getenv("PATH").get() + ":/usr/sbin:/usr/local/sbin");
+
+  return os::system(
+      "{ command -v kdb5_util && command -v kadmin.local && "
+      "command -v krb5kdc; } >/dev/null 2>&1") == 0;
+}
+
+
+void KDC::addPrincipal(const string& principal, const string& keytab)
+{
+  run("kadmin.local -q 'addprinc -randkey " + principal + "'");
+  run("kadmin.local -q 'ktadd -k " + path::join(directory, keytab) + " " +
+      principal + "'");
+}
+
+
+void KDC::run(const string& command)
+{
+  CHECK_EQ(0, os::system(command + " >>" +
+                         path::join(directory, "setup.log") + " 2>&1"))
+    << "Failed to run '" << command << "', see "
+    << path::join(directory, "setup.log");
+}
+
+
+int KDC::freePort()
+{
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  CHECK_NE(-1, s);
+
+  sockaddr_in address;
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  socklen_t length = sizeof(address);
+  CHECK_EQ(0, bind(s, (sockaddr*) &address, length));
+  CHECK_EQ(0, getsockname(s, (sockaddr*) &address, &length));
+
+  close(s);
+
+  return ntohs(address.sin_port);
+}
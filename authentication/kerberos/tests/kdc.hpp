@@ -0,0 +1,52 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+#ifndef __AUTHENTICATION_GSSAPI_TESTS_KDC_HPP__
+#define __AUTHENTICATION_GSSAPI_TESTS_KDC_HPP__
+
+#include <string>
+
+// A MIT KDC of 'REALM' serving from a directory, for the tests and
+// benchmarks running handshakes against a real KDC. It has a keytab
+// for the 'mesos' service at a given host and one for the 'AGENT',
+// and points the Kerberos library at them through the environment.
+class KDC
+{
+public:
+  static const char REALM[];
+
+  // Principal of the agent, the only one in the client keytab.
+  static const char AGENT[];
+
+  KDC(const std::string& directory, const std::string& host);
+  ~KDC();
+
+  // Whether the MIT KDC tools are available. Adds sbin, where they
+  // usually live, to the PATH.
+  static bool installed();
+
+private:
+  void addPrincipal(const std::string& principal, const std::string& keytab);
+  void run(const std::string& command);
+
+  // Returns a TCP port which is free right now.
+  static int freePort();
+
+  const std::string directory;
+  const std::string pid;
+};
+
+#endif // __AUTHENTICATION_GSSAPI_TESTS_KDC_HPP__
@@ -0,0 +1,446 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+// Handshakes of the native GSS-API authenticator and authenticatee
+// over loopback against a MIT KDC started in a temporary directory,
+// run through 'make check'. Gets skipped if the MIT KDC tools are not
+// installed. Exits with a failure as soon as a check does not hold.
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+
+#include <gssapi/gssapi.h>
+
+#include <mesos/mesos.hpp>
+
+#include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/pid.hpp>
+#include <process/process.hpp>
+#include <process/protobuf.hpp>
+
+#include <glog/logging.h>
+
+#include <stout/check.hpp>
+#include <stout/duration.hpp>
+#include <stout/net.hpp>
+#include <stout/option.hpp>
+#include <stout/os.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/kerberos/authenticatee.hpp"
+#include "authentication/kerberos/authenticator.hpp"
+#include "authentication/kerberos/gss.hpp"
+#include "authentication/kerberos/native_authenticatee.hpp"
+#include "authentication/kerberos/native_authenticator.hpp"
+
+#include "authentication/kerberos/tests/kdc.hpp"
+
+using namespace mesos::internal::gssapi;
+using namespace process;
+
+using mesos::Credential;
+
+using mesos::internal::AuthenticateMessage;
+using mesos::internal::AuthenticationMechanismsMessage;
+using mesos::internal::AuthenticationStartMessage;
+
+using std::cerr;
+using std::endl;
+using std::string;
+
+// Exit code telling the automake test driver that a test got skipped.
+static const int SKIPPED = 77;
+
+
+// Stands in for the master: hands every authenticatee asking to get
+// authenticated over to the authenticator and keeps the outcome of
+// the latest session.
+class MasterProcess : public ProtobufProcess<MasterProcess>
+{
+public:
+  explicit MasterProcess(NativeGSSAPIAuthenticator* _authenticator)
+    : ProcessBase(ID::generate("master")),
+      authenticator(_authenticator) {}
+
+  Future<Option<string>> principal()
+  {
+    return promise.future();
+  }
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticateMessage>(&MasterProcess::authenticate);
+  }
+
+  void authenticate(const UPID& from, const AuthenticateMessage& message)
+  {
+    promise.associate(authenticator->authenticate(from));
+  }
+
+private:
+  NativeGSSAPIAuthenticator* authenticator;
+  Promise<Option<string>> promise;
+};
+
+
+// Answers the mechanisms offered by the authenticator with a start
+// carrying a given AP-REQ, like an attacker replaying a captured one.
+class ReplayingAgentProcess : public ProtobufProcess<ReplayingAgentProcess>
+{
+public:
+  explicit ReplayingAgentProcess(const string& _token)
+    : ProcessBase(ID::generate("agent")), token(_token) {}
+
+protected:
+  virtual void initialize()
+  {
+    install<AuthenticationMechanismsMessage>(
+        &ReplayingAgentProcess::mechanisms);
+  }
+
+  void mechanisms(
+      const UPID& from,
+      const AuthenticationMechanismsMessage& message)
+  {
+    AuthenticationStartMessage start;
+    start.set_mechanism(NATIVE_GSSAPI_MECHANISM);
+    start.set_data(token);
+    send(from, start);
+  }
+
+private:
+  const string token;
+};
+
+
+// Returns an AP-REQ of the agent for the 'mesos' service at 'host',
+// asking for mutual authentication like the authenticatee does.
+static string apReq(const string& host)
+{
+  Try<gss_name_t> target = serviceName("mesos", host);
+  CHECK_SOME(target);
+
+  OM_uint32 minor;
+  gss_ctx_id_t context = GSS_C_NO_CONTEXT;
+  gss_buffer_desc output = GSS_C_EMPTY_BUFFER;
+
+  OM_uint32 major = gss_init_sec_context(
+      &minor,
+      GSS_C_NO_CREDENTIAL,
+      &context,
+      target.get(),
+      GSS_C_NO_OID,
+      GSS_C_MUTUAL_FLAG,
+      0,
+      GSS_C_NO_CHANNEL_BINDINGS,
+      GSS_C_NO_BUFFER,
+      NULL,
+      &output,
+      NULL,
+      NULL);
+
+  CHECK(!GSS_ERROR(major)) << status(major, minor);
+
+  const string token(static_cast<const char*>(output.value), output.length);
+
+  gss_name_t target_ = target.get();
+  gss_release_name(&minor, &target_);
+  gss_release_buffer(&minor, &output);
+  gss_delete_sec_context(&minor, &context, GSS_C_NO_BUFFER);
+
+  return token;
+}
+
+
+// Has the authenticator accept 'token' in a session of its own,
+// returning the principal it authenticated, if any.
+static Option<string> accept(
+    NativeGSSAPIAuthenticator* authenticator,
+    const string& token)
+{
+  ReplayingAgentProcess agent(token);
+  spawn(agent);
+
+  Future<Option<string>> principal = authenticator->authenticate(agent.self());
+  principal.await();
+
+  terminate(agent);
+  wait(agent);
+
+  CHECK(principal.isReady())
+    << (principal.isFailed() ? principal.failure() : "discarded");
+
+  return principal.get();
+}
+
+
+// Options of the authenticatees of the tests, giving a KDC which is
+// still starting up a few tries.
+static GSSAPIAuthenticatee::Options authenticateeOptions()
+{
+  GSSAPIAuthenticatee::Options options;
+  options.handshakeTimeout = Seconds(10);
+  options.maxAttempts = 10;
+  options.retryBackoffMax = Seconds(1);
+  return options;
+}
+
+
+// Authenticates 'principal' through a fresh authenticator and
+// authenticatee, returning the outcome at the authenticatee and the
+// principal the authenticator saw, if any.
+static Future<bool> authenticate(
+    const string& principal,
+    bool earlyStart,
+    Option<string>* authenticated)
+{
+  GSSAPIAuthenticator::Options authenticatorOptions;
+  authenticatorOptions.acceptEarlyStarts = earlyStart;
+
+  NativeGSSAPIAuthenticator authenticator;
+  authenticator.prepare("mesos", "", KDC::REALM, authenticatorOptions);
+
+  Try<Nothing> initialize = authenticator.initialize(None());
+  CHECK_SOME(initialize);
+
+  MasterProcess master(&authenticator);
+  spawn(master);
+
+  GSSAPIAuthenticatee::Options options = authenticateeOptions();
+  options.optimisticStart = earlyStart;
+
+  NativeGSSAPIAuthenticatee authenticatee;
+  authenticatee.prepare("mesos", "", options);
+
+  Credential credential;
+  credential.set_principal(principal);
+
+  Future<bool> future =
+    authenticatee.authenticate(master.self(), UPID(), credential);
+  future.await();
+
+  Future<Option<string>> outcome = master.principal();
+  if (future.isReady() && future.get()) {
+    outcome.await();
+    CHECK(outcome.isReady());
+    *authenticated = outcome.get();
+  }
+
+  terminate(master);
+  wait(master);
+
+  return future;
+}
+
+
+// The agent completes a handshake, negotiating the mechanism first,
+// and the authenticator learns its principal.
+static void testHandshake()
+{
+  Option<string> principal;
+  Future<bool> authenticated = authenticate(KDC::AGENT, false, &principal);
+
+  CHECK(authenticated.isReady())
+    << (authenticated.isFailed() ? authenticated.failure() : "discarded");
+  CHECK(authenticated.get());
+  CHECK_SOME(principal);
+  CHECK_EQ(string(KDC::AGENT) + "@" + KDC::REALM, principal.get());
+}
+
+
+// Same with the AP-REQ sent along with the request.
+static void testEarlyStart()
+{
+  Option<string> principal;
+  Future<bool> authenticated = authenticate(KDC::AGENT, true, &principal);
+
+  CHECK(authenticated.isReady())
+    << (authenticated.isFailed() ? authenticated.failure() : "discarded");
+  CHECK(authenticated.get());
+  CHECK_SOME(principal);
+  CHECK_EQ(string(KDC::AGENT) + "@" + KDC::REALM, principal.get());
+}
+
+
+// A principal without a key never gets a ticket.
+static void testUnknownPrincipal()
+{
+  Option<string> principal;
+  Future<bool> authenticated = authenticate("nobody", false, &principal);
+
+  CHECK(!authenticated.isReady() || !authenticated.get());
+  CHECK_NONE(principal);
+}
+
+
+// Waits for 'future', returns whether it completed authenticated.
+static bool succeeded(Future<bool> future)
+{
+  future.await();
+  return future.isReady() && future.get();
+}
+
+
+// One authenticatee authenticates repeatedly and, against the same
+// master, concurrently, where the later authentication supersedes the
+// earlier one. A second authenticatee of the same client shares the
+// process, hence supersedes as well, and deleting an authenticatee
+// ends its authentications.
+static void testReuse()
+{
+  GSSAPIAuthenticator::Options authenticatorOptions;
+  authenticatorOptions.preemptStaleSessions = true;
+
+  NativeGSSAPIAuthenticator authenticator;
+  authenticator.prepare("mesos", "", KDC::REALM, authenticatorOptions);
+
+  Try<Nothing> initialize = authenticator.initialize(None());
+  CHECK_SOME(initialize);
+
+  MasterProcess master(&authenticator);
+  spawn(master);
+
+  Credential credential;
+  credential.set_principal(KDC::AGENT);
+
+  NativeGSSAPIAuthenticatee authenticatee;
+  authenticatee.prepare("mesos", "", authenticateeOptions());
+
+  CHECK(succeeded(
+      authenticatee.authenticate(master.self(), UPID(), credential)));
+  CHECK(succeeded(
+      authenticatee.authenticate(master.self(), UPID(), credential)));
+
+  Future<bool> superseded =
+    authenticatee.authenticate(master.self(), UPID(), credential);
+  Future<bool> latest =
+    authenticatee.authenticate(master.self(), UPID(), credential);
+
+  CHECK(succeeded(latest));
+  superseded.await();
+  CHECK(superseded.isFailed());
+
+  NativeGSSAPIAuthenticatee other;
+  other.prepare("mesos", "", authenticateeOptions());
+
+  superseded = authenticatee.authenticate(master.self(), UPID(), credential);
+  latest = other.authenticate(master.self(), UPID(), credential);
+
+  CHECK(succeeded(latest));
+  superseded.await();
+  CHECK(superseded.isFailed());
+
+  Future<bool> discarded;
+  {
+    NativeGSSAPIAuthenticatee deleted;
+    deleted.prepare("mesos", "", authenticateeOptions());
+    discarded = deleted.authenticate(master.self(), UPID(), credential);
+  }
+
+  discarded.await();
+  CHECK(!discarded.isReady());
+
+  // The shared process keeps serving.
+  CHECK(succeeded(
+      other.authenticate(master.self(), UPID(), credential)));
+
+  terminate(master);
+  wait(master);
+}
+
+
+// With the in-memory replay cache, which stands in for the one of
+// Kerberos, an AP-REQ gets accepted once. Neither the same AP-REQ nor
+// one with altered ap-options, which are not integrity protected,
+// passes a second time.
+static void testReplay(const string& host)
+{
+  GSSAPIAuthenticator::Options options;
+  options.memoryReplayCache = true;
+
+  NativeGSSAPIAuthenticator authenticator;
+  authenticator.prepare("mesos", "", KDC::REALM, options);
+
+  Try<Nothing> initialize = authenticator.initialize(None());
+  CHECK_SOME(initialize);
+
+  const string token = apReq(host);
+
+  Option<string> principal = accept(&authenticator, token);
+  CHECK_SOME(principal);
+  CHECK_EQ(string(KDC::AGENT) + "@" + KDC::REALM, principal.get());
+
+  CHECK_NONE(accept(&authenticator, token));
+
+  // Clear mutual-required in the ap-options, an AP-REQ has them right
+  // ahead of the ticket as a five byte BIT STRING.
+  const string options_("\xa2\x07\x03\x05\x00", 5);
+  const size_t offset = token.find(options_);
+  CHECK_NE(string::npos, offset);
+
+  string altered = token;
+  altered[offset + options_.size()] ^= 0x20;
+  CHECK_NE(token, altered);
+
+  CHECK_NONE(accept(&authenticator, altered));
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  if (!KDC::installed()) {
+    cerr << "Skipping, the MIT KDC tools are not installed" << endl;
+    return SKIPPED;
+  }
+
+  // Have the authenticator listen on loopback, the authenticatee
+  // names the service after the reverse lookup of that address.
+  os::setenv("LIBPROCESS_IP", "127.0.0.1");
+
+  Try<net::IP> loopback = net::IP::parse("127.0.0.1", AF_INET);
+  CHECK_SOME(loopback);
+
+  Try<string> host = net::getHostname(loopback.get());
+  if (host.isError()) {
+    cerr << "Skipping, failed to resolve the loopback address: "
+         << host.error() << endl;
+    return SKIPPED;
+  }
+
+  Try<string> directory = os::mkdtemp();
+  CHECK_SOME(directory);
+
+  {
+    KDC kdc(directory.get(), host.get());
+
+    testHandshake();
+    testEarlyStart();
+    testUnknownPrincipal();
+    testReplay(host.get());
+    testReuse();
+  }
+
+  os::rmdir(directory.get());
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,254 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+// Benchmarks of the replay cache against a MIT KDC started in a
+// temporary directory, run through 'make bench'. Compares the accepts
+// per second of AP-REQs with the file backed replay cache of Kerberos
+// to those with the Kerberos one skipped and the in-memory ReplayCache
+// in its place, for a few numbers of threads accepting at once. The
+// AP-REQs are obtained up front so that only the acceptor gets timed.
+// Gets skipped if the MIT KDC tools are not installed. Prints one JSON
+// object per run.
+//
+// Usage: kerberos-replay-cache-benchmarks [AP-REQs per run]
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gssapi/gssapi.h>
+
+#include <glog/logging.h>
+
+#include <stout/check.hpp>
+#include <stout/foreach.hpp>
+#include <stout/json.hpp>
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/kerberos/gss.hpp"
+#include "authentication/kerberos/replay_cache.hpp"
+
+#include "authentication/kerberos/tests/kdc.hpp"
+
+using namespace mesos::internal::gssapi;
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+typedef std::chrono::steady_clock SteadyClock;
+
+// The host the acceptor names itself after, no DNS involved.
+static const char HOST[] = "localhost";
+
+static const size_t THREADS[] = {1, 4, 16};
+
+
+// Obtains 'count' AP-REQs of the agent for the 'mesos' service. None
+// asks for mutual authentication, so each is complete on its own.
+static vector<string> tokens(gss_name_t target, size_t count)
+{
+  vector<string> tokens;
+
+  for (size_t i = 0; i < count; i++) {
+    OM_uint32 minor;
+    gss_ctx_id_t context = GSS_C_NO_CONTEXT;
+    gss_buffer_desc output = GSS_C_EMPTY_BUFFER;
+
+    OM_uint32 major = gss_init_sec_context(
+        &minor,
+        GSS_C_NO_CREDENTIAL,
+        &context,
+        target,
+        GSS_C_NO_OID,
+        0,          // Flags.
+        0,          // Lifetime.
+        GSS_C_NO_CHANNEL_BINDINGS,
+        GSS_C_NO_BUFFER,
+        NULL,       // Actual mechanism.
+        &output,
+        NULL,       // Actual flags.
+        NULL);      // Actual lifetime.
+
+    CHECK_EQ(GSS_S_COMPLETE, major) << status(major, minor);
+
+    tokens.push_back(
+        string(static_cast<const char*>(output.value), output.length));
+
+    gss_release_buffer(&minor, &output);
+    gss_delete_sec_context(&minor, &context, GSS_C_NO_BUFFER);
+  }
+
+  return tokens;
+}
+
+
+// Accepts every 'stride'th of 'tokens' from 'offset' on, recording each
+// in 'replays' unless it is NULL.
+static void accept(
+    gss_cred_id_t credential,
+    ReplayCache* replays,
+    const vector<string>* tokens,
+    size_t offset,
+    size_t stride)
+{
+  for (size_t i = offset; i < tokens->size(); i += stride) {
+    const string& token = (*tokens)[i];
+
+    gss_buffer_desc input;
+    input.value = const_cast<char*>(token.data());
+    input.length = token.size();
+
+    OM_uint32 minor;
+    gss_ctx_id_t context = GSS_C_NO_CONTEXT;
+    gss_name_t client = GSS_C_NO_NAME;
+    gss_buffer_desc output = GSS_C_EMPTY_BUFFER;
+
+    OM_uint32 major = gss_accept_sec_context(
+        &minor,
+        &context,
+        credential,
+        &input,
+        GSS_C_NO_CHANNEL_BINDINGS,
+        &client,
+        NULL,       // Mechanism.
+        &output,
+        NULL,       // Flags.
+        NULL,       // Lifetime of the context.
+        NULL);      // Delegated credentials.
+
+    CHECK_EQ(GSS_S_COMPLETE, major) << status(major, minor);
+
+    if (replays != NULL) {
+      gss_buffer_desc name = GSS_C_EMPTY_BUFFER;
+      major = gss_display_name(&minor, client, &name, NULL);
+      CHECK_EQ(GSS_S_COMPLETE, major) << status(major, minor);
+
+      CHECK(replays->insert(
+          string(static_cast<const char*>(name.value), name.length),
+          token));
+
+      gss_release_buffer(&minor, &name);
+    }
+
+    gss_release_buffer(&minor, &output);
+    gss_release_name(&minor, &client);
+    gss_delete_sec_context(&minor, &context, GSS_C_NO_BUFFER);
+  }
+}
+
+
+// Accepts 'count' fresh AP-REQs on 'threads' threads, with the file
+// backed replay cache of Kerberos or with the in-memory one.
+static void benchmark(
+    gss_name_t name,
+    size_t count,
+    size_t threads,
+    bool memory)
+{
+  Try<gss_cred_id_t> credential = acceptorCredential(name, !memory);
+  CHECK(credential.isSome()) << credential.error();
+
+  ReplayCache replays(DEFAULT_REPLAY_CACHE_SHARDS, DEFAULT_CLOCK_SKEW);
+
+  const vector<string> requests = tokens(name, count);
+
+  const SteadyClock::time_point start = SteadyClock::now();
+
+  vector<std::thread> workers;
+  for (size_t i = 0; i < threads; i++) {
+    workers.push_back(std::thread(
+        &accept,
+        credential.get(),
+        memory ? &replays : NULL,
+        &requests,
+        i,
+        threads));
+  }
+
+  foreach (std::thread& worker, workers) {
+    worker.join();
+  }
+
+  const double total = std::chrono::duration<double, std::milli>(
+      SteadyClock::now() - start).count();
+
+  JSON::Object result;
+  result.values["benchmark"] = "replay_cache";
+  result.values["replay_cache"] = memory ? "memory" : "file";
+  result.values["threads"] = threads;
+  result.values["accepts"] = count;
+  result.values["accepts_per_second"] = count / (total / 1000);
+  result.values["total_ms"] = total;
+
+  cout << stringify(result) << endl;
+
+  OM_uint32 minor;
+  gss_cred_id_t credential_ = credential.get();
+  gss_release_cred(&minor, &credential_);
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  size_t count = 10000;
+
+  if (argc > 1) {
+    Try<size_t> requests = numify<size_t>(argv[1]);
+    CHECK(requests.isSome()) << "Invalid AP-REQs per run: " << argv[1];
+    count = requests.get();
+  }
+
+  // 'make bench' stops at the first failing benchmark.
+  if (!KDC::installed()) {
+    cerr << "Skipping, the MIT KDC tools are not installed" << endl;
+    return EXIT_SUCCESS;
+  }
+
+  Try<string> directory = os::mkdtemp();
+  CHECK_SOME(directory);
+
+  {
+    KDC kdc(directory.get(), HOST);
+
+    Try<gss_name_t> name = serviceName("mesos", HOST);
+    CHECK(name.isSome()) << name.error();
+
+    foreach (size_t threads, THREADS) {
+      benchmark(name.get(), count, threads, false);
+      benchmark(name.get(), count, threads, true);
+    }
+
+    OM_uint32 minor;
+    gss_name_t name_ = name.get();
+    gss_release_name(&minor, &name_);
+  }
+
+  os::rmdir(directory.get());
+
+  return EXIT_SUCCESS;
+}
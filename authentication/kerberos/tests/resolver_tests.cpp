@@ -0,0 +1,254 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+// Tests of the Resolver cache against a stub resolver, run through
+// 'make check'. Time is controlled through the libprocess clock. Exits
+// with a failure as soon as a check does not hold.
+
+#include <arpa/inet.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <glog/logging.h>
+
+#include <process/clock.hpp>
+#include <process/future.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/error.hpp>
+#include <stout/lambda.hpp>
+#include <stout/net.hpp>
+#include <stout/stringify.hpp>
+#include <stout/try.hpp>
+
+#include "authentication/kerberos/resolver.hpp"
+
+using namespace mesos::internal::gssapi;
+
+using process::Clock;
+using process::Future;
+
+using std::string;
+
+static const Duration TTL = Minutes(10);
+static const Duration NEGATIVE_TTL = Seconds(30);
+
+
+// Stands in for the system resolver, answering from a hosts table and
+// failing for all other addresses. Lookups can be held back to have
+// several requests wait for the same lookup.
+class StubResolver
+{
+public:
+  StubResolver() : lookups(0), held(false) {}
+
+  Try<string> lookup(const net::IP& ip)
+  {
+    lookups++;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    released.wait(lock, [this]() { return !held; });
+
+    std::map<string, string>::const_iterator host = hosts.find(stringify(ip));
+    if (host == hosts.end()) {
+      return Error("Unknown host " + stringify(ip));
+    }
+
+    return host->second;
+  }
+
+  void hold()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    held = true;
+  }
+
+  void release()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      held = false;
+    }
+    released.notify_all();
+  }
+
+  // Maps addresses to hostnames, only to be changed between lookups.
+  std::map<string, string> hosts;
+
+  std::atomic<int> lookups;
+
+private:
+  std::mutex mutex;
+  std::condition_variable released;
+  bool held;
+};
+
+
+static net::IP address(const string& value)
+{
+  Try<net::IP> ip = net::IP::parse(value, AF_INET);
+  CHECK(ip.isSome()) << ip.error();
+  return ip.get();
+}
+
+
+static string resolve(Resolver& resolver, const net::IP& ip)
+{
+  Future<string> hostname = resolver.resolve(ip, TTL, NEGATIVE_TTL);
+  hostname.await();
+
+  CHECK(hostname.isReady())
+    << (hostname.isFailed() ? hostname.failure() : "discarded");
+
+  return hostname.get();
+}
+
+
+static void fail(Resolver& resolver, const net::IP& ip)
+{
+  Future<string> hostname = resolver.resolve(ip, TTL, NEGATIVE_TTL);
+  hostname.await();
+
+  CHECK(hostname.isFailed());
+}
+
+
+// Resolved hostnames are served from the cache until 'TTL' passed.
+static void testTtl()
+{
+  StubResolver stub;
+  stub.hosts["10.0.0.1"] = "master1.example.com";
+
+  Resolver resolver(lambda::bind(&StubResolver::lookup, &stub, lambda::_1));
+
+  const net::IP ip = address("10.0.0.1");
+
+  Clock::pause();
+
+  CHECK_EQ("master1.example.com", resolve(resolver, ip));
+  CHECK_EQ(1, stub.lookups.load());
+
+  // A changed record does not show until the entry expired.
+  stub.hosts["10.0.0.1"] = "master2.example.com";
+
+  Clock::advance(TTL - Seconds(1));
+
+  CHECK_EQ("master1.example.com", resolve(resolver, ip));
+  CHECK_EQ(1, stub.lookups.load());
+
+  Clock::advance(Seconds(1));
+
+  CHECK_EQ("master2.example.com", resolve(resolver, ip));
+  CHECK_EQ(2, stub.lookups.load());
+
+  Clock::resume();
+}
+
+
+// Failed lookups are served from the cache until 'NEGATIVE_TTL'
+// passed, a host which became resolvable shows after that.
+static void testNegativeTtl()
+{
+  StubResolver stub;
+
+  Resolver resolver(lambda::bind(&StubResolver::lookup, &stub, lambda::_1));
+
+  const net::IP ip = address("10.0.0.2");
+
+  Clock::pause();
+
+  fail(resolver, ip);
+  CHECK_EQ(1, stub.lookups.load());
+
+  stub.hosts["10.0.0.2"] = "master.example.com";
+
+  Clock::advance(NEGATIVE_TTL - Seconds(1));
+
+  fail(resolver, ip);
+  CHECK_EQ(1, stub.lookups.load());
+
+  Clock::advance(Seconds(1));
+
+  CHECK_EQ("master.example.com", resolve(resolver, ip));
+  CHECK_EQ(2, stub.lookups.load());
+
+  // The hostname now is cached for the positive TTL.
+  Clock::advance(NEGATIVE_TTL);
+
+  CHECK_EQ("master.example.com", resolve(resolver, ip));
+  CHECK_EQ(2, stub.lookups.load());
+
+  Clock::resume();
+}
+
+
+// Requests for an address being looked up wait for that lookup rather
+// than starting one of their own. Nothing gets cached here so that
+// only the sharing of the lookup can save the second one.
+static void testConcurrentRequests()
+{
+  StubResolver stub;
+  stub.hosts["10.0.0.3"] = "master3.example.com";
+
+  Resolver resolver(lambda::bind(&StubResolver::lookup, &stub, lambda::_1));
+
+  const net::IP ip = address("10.0.0.3");
+
+  stub.hold();
+
+  Future<string> first =
+    resolver.resolve(ip, Duration::zero(), Duration::zero());
+  Future<string> second =
+    resolver.resolve(ip, Duration::zero(), Duration::zero());
+
+  // Once the lookup started both requests are queued ahead of its
+  // result.
+  while (stub.lookups.load() == 0) {
+    std::this_thread::yield();
+  }
+
+  stub.release();
+
+  first.await();
+  second.await();
+
+  CHECK(first.isReady());
+  CHECK(second.isReady());
+  CHECK_EQ("master3.example.com", first.get());
+  CHECK_EQ("master3.example.com", second.get());
+  CHECK_EQ(1, stub.lookups.load());
+
+  CHECK_EQ("master3.example.com", resolve(resolver, ip));
+  CHECK_EQ(2, stub.lookups.load());
+}
+
+
+int main(int argc, char** argv)
+{
+  google::InitGoogleLogging(argv[0]);
+
+  testTtl();
+  testNegativeTtl();
+  testConcurrentRequests();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#include <stout/check.hpp>
+#include <stout/foreach.hpp>
+
+#include "worker_pool.hpp"
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+WorkerPool::WorkerPool(size_t _threads) : stopping(false)
+{
+  CHECK_GT(_threads, 0u);
+
+  for (size_t i = 0; i < _threads; i++) {
+    threads.push_back(std::thread(&WorkerPool::run, this));
+  }
+}
+
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+
+  condition.notify_all();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+}
+
+
+void WorkerPool::enqueue(const std::function<void()>& task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(!stopping);
+    tasks.push(task);
+  }
+
+  condition.notify_one();
+}
+
+
+void WorkerPool::run()
+{
+  while (true) {
+    std::function<void()> task;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      while (tasks.empty() && !stopping) {
+        condition.wait(lock);
+      }
+
+      if (tasks.empty()) {
+        return; // Stopping and drained.
+      }
+
+      task = tasks.front();
+      tasks.pop();
+    }
+
+    task();
+  }
+}
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
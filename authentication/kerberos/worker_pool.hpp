@@ -0,0 +1,62 @@
+/**
+ * Copyright 2014-present Mesosphere Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*/
+
+
+#ifndef __AUTHENTICATION_GSSAPI_WORKER_POOL_HPP__
+#define __AUTHENTICATION_GSSAPI_WORKER_POOL_HPP__
+
+#include <stddef.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace mesos {
+namespace internal {
+namespace gssapi {
+
+// A fixed number of threads running tasks in FIFO order. Meant for
+// blocking or CPU heavy calls, e.g., into SASL and Kerberos, which
+// should not occupy the threads libprocess runs its processes on.
+class WorkerPool
+{
+public:
+  explicit WorkerPool(size_t threads);
+
+  // Runs all tasks enqueued so far before returning.
+  ~WorkerPool();
+
+  void enqueue(const std::function<void()>& task);
+
+private:
+  void run();
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::queue<std::function<void()>> tasks;
+  bool stopping;
+
+  std::vector<std::thread> threads;
+};
+
+} // namespace gssapi {
+} // namespace internal {
+} // namespace mesos {
+
+#endif //__AUTHENTICATION_GSSAPI_WORKER_POOL_HPP__